@@ -1,13 +1,36 @@
 #include "SSDAnalyzer.h"
 #include "SSDAnalyzerSettings.h"
+#include "SSDCalibration.h"
 #include <AnalyzerChannelData.h>
 #include <math.h>
 #include <stdio.h>
+#include <thread>
 
 SSDAnalyzer::SSDAnalyzer()
     : Analyzer2(),
     mSettings(new SSDAnalyzerSettings()),
-    mSimulationInitilized(false)
+    mSimulationInitilized(false),
+    mProgressSamples(1),
+    mExitCheckSamples(1),
+    mNextProgress(0),
+    mPostFrame(&SSDAnalyzer::PostFrameAs<true, true>),
+    mCurrentMode(0),
+    mSpanStart(0),
+    mSpanPending(false),
+    mPacketStart(0),
+    mPacketData(0),
+    mPacketPreambleBits(0),
+    mPacketDataCount(0),
+    mFoldOpen(false),
+    mFoldDropEnd(false),
+    mReplaying(false),
+    mFoldStart(0),
+    mFoldData(0),
+    mRepeatCount(0),
+    mRepeatStart(0),
+    mRepeatEnd(0),
+    mRepeatCommand(0),
+    mPendingFrames(0)
 {
     SetAnalyzerSettings(mSettings.get());
 }
@@ -24,65 +47,270 @@ void SSDAnalyzer::SetupResults()
     mResults->AddChannelBubblesWillAppearOn(mSettings->mInputChannel);
 }
 
-UINT SSDAnalyzer::LookaheadNextHBit(U64* nSample)
+const char* SSDAnalyzer::GetCurrentPacketColor()
 {
-    UINT nHBitLen = (UINT)(mSSD->GetSampleOfNextEdge() - *nSample);
-    *nSample = mSSD->GetSampleOfNextEdge();
-
-    if (nHBitLen >= mMin1hbit && nHBitLen <= mMax1hbit)
-        return 1;
-    else if (nHBitLen >= mMin0hbit && nHBitLen <= mMax0hbit)
-        return 0;
-    else if (nHBitLen >= mMinPEHold && nHBitLen <= mMaxPGap) {
-        return 3; // Packet gap
+    // Retourne la couleur appropriee selon le mode du paquet actuel
+    switch (mCurrentMode) {
+    case SSD_MODE_RACE:
+        return "ssd_race";      // VERT
+    case SSD_MODE_PROGRAM:
+        return "ssd_program";   // BLEU
+    default:
+        return "ssd_unknown";   // ORANGE
     }
-    else
-        return BIT_ERROR_FLAG; // bit error
 }
 
-UINT SSDAnalyzer::GetNextHBit(U64* nSample)
+void SSDAnalyzer::OnFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2, U8 nPacketMode)
 {
-    U64 nSampNumber = *nSample;
-    mSSD->AdvanceToNextEdge();
-    *nSample = mSSD->GetSampleNumber();
-    UINT nHBitLen = (UINT)(mSSD->GetSampleNumber() - nSampNumber);
+    mCurrentMode = nPacketMode;
 
-    if (nHBitLen >= mMin1hbit && nHBitLen <= mMax1hbit)
-        return 1;
-    else if (nHBitLen >= mMin0hbit && nHBitLen <= mMax0hbit)
-        return 0;
+    if (mSettings->mFoldRepeats && !mReplaying)
+        FoldFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2);
     else
-        return BIT_ERROR_FLAG; // bit error
+        ShapeFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2);
+
+    // La politique de commit suit les frames du decodeur, meme non affichees
+    if (mPendingFrames != 0 && IsCommitDue(ft))
+        CommitFrames();
 }
 
-UINT SSDAnalyzer::GetNextBit(U64* nSample)
+void SSDAnalyzer::ShapeFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2)
 {
-    U64 nTemp = *nSample;
-    UINT nHBit1 = GetNextHBit(nSample);
-    UINT nHBit2 = GetNextHBit(nSample);
+    switch (mSettings->mFrameMode) {
+    case SSDAnalyzerEnums::FRAMES_COMPACT:
+        PostCompactFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2);
+        break;
+    case SSDAnalyzerEnums::FRAMES_PACKET:
+        PostPacketFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2);
+        break;
+    default:
+        PostFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2);
+        break;
+    }
+}
 
-    if ((nHBit1 > 1) || (nHBit2 > 1) || ((UINT)(*nSample - nTemp) > mMaxBitLen))
-        return BIT_ERROR_FLAG;      // bit error
-    else if (nHBit1 != nHBit2)
-        return FRAMING_ERROR_FLAG;  // frame error
-    else
-        return nHBit1;
+void SSDAnalyzer::OnMarker(U64 nSample, eMarkerType marker)
+{
+    if (mSettings->mFoldRepeats && !mReplaying) {
+        if (mFoldOpen) {
+            mFoldFrames.OnMarker(nSample, marker);
+            return;
+        }
+        if (mFoldDropEnd && marker == MARKER_STOP)
+            return;
+    }
+
+    ShapeMarker(nSample, marker);
 }
 
-const char* SSDAnalyzer::GetCurrentPacketColor()
+void SSDAnalyzer::ShapeMarker(U64 nSample, eMarkerType marker)
 {
-    // Retourne la couleur appropriee selon le mode du paquet actuel
-    switch (mCurrentMode) {
-    case SSD_MODE_RACE:
-        return "ssd_race";      // VERT
-    case SSD_MODE_PROGRAM:
-        return "ssd_program";   // BLEU
+    // Meme ordre que eMarkerType
+    static const AnalyzerResults::MarkerType sMarkers[] = {
+        AnalyzerResults::Start, AnalyzerResults::Stop, AnalyzerResults::ErrorDot,
+        AnalyzerResults::ErrorSquare, AnalyzerResults::ErrorX
+    };
+
+    // Start/Stop marquent les bits de framing, qui n'ont plus leur propre frame
+    if (mSettings->mFrameMode != SSDAnalyzerEnums::FRAMES_FULL &&
+        (marker == MARKER_START || marker == MARKER_STOP))
+        return;
+
+    mResults->AddMarker(nSample, sMarkers[marker], mSettings->mInputChannel);
+}
+
+void SSDAnalyzer::FoldFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2)
+{
+    // Les frames d'un paquet sont gardees jusqu'au checksum: on sait alors
+    // s'il repete le dernier paquet de la meme commande
+    switch (ft) {
+    case FRAME_PREAMBLE:
+        mFoldFrames.Clear();
+        mFoldOpen = true;
+        mFoldDropEnd = false;
+        mFoldStart = nStartSample;
+        mFoldData = 0;
+        mFoldFrames.OnFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2, mCurrentMode);
+        return;
+
+    case FRAME_PSBIT:
+    case FRAME_CMDBYTE:
+    case FRAME_DSBIT:
+    case FRAME_CARDATA:
+        if (!mFoldOpen)
+            break;
+        if (ft == FRAME_CMDBYTE)
+            mFoldData = Data1 & 0xFF;
+        else if (ft == FRAME_CARDATA && Data2 >= 1 && Data2 <= 6)
+            mFoldData |= (Data1 & 0xFF) << (8 * Data2);
+        mFoldFrames.OnFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2, mCurrentMode);
+        return;
+
+    case FRAME_CHECKSUM:
+    {
+        if (!mFoldOpen)
+            break;
+        mFoldData |= (Data1 & 0xFF) << (8 * PACKET_CHECKSUM_INDEX);
+        mFoldFrames.OnFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2, mCurrentMode);
+        mFoldOpen = false;
+
+        U8 nCommand = (U8)mFoldData;
+        bool bValid = (Flags & CHECKSUM_ERROR_FLAG) == 0;
+
+        if (bValid && mLastPacketValid[nCommand] && mLastPacket[nCommand] == mFoldData) {
+            // Paquet inchange: il rejoint le "repeat xN" en cours
+            if (mRepeatCount != 0 && mRepeatCommand != nCommand)
+                FlushRepeat();
+            if (mRepeatCount == 0) {
+                mRepeatStart = mFoldStart;
+                mRepeatCommand = nCommand;
+                mRepeatOpened = std::chrono::steady_clock::now();
+            }
+            mRepeatEnd = nEndSample;
+            mRepeatCount++;
+            mFoldDropEnd = true;
+        }
+        else {
+            FlushRepeat();
+            ReplayPacket();
+            if (bValid) {
+                mLastPacket[nCommand] = mFoldData;
+                mLastPacketValid[nCommand] = true;
+            }
+        }
+        mFoldFrames.Clear();
+        return;
+    }
+
+    case FRAME_PEBIT:
+        if (mFoldDropEnd) {
+            mFoldDropEnd = false;
+            return;
+        }
+        break;
+
     default:
-        return "ssd_unknown";   // ORANGE
+        // Erreur: le debut du paquet interrompu est affiche tel quel
+        FlushRepeat();
+        if (mFoldOpen)
+            ReplayPacket();
+        mFoldOpen = false;
+        mFoldDropEnd = false;
+        mFoldFrames.Clear();
+        break;
+    }
+
+    ShapeFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2);
+}
+
+void SSDAnalyzer::ReplayPacket()
+{
+    U8 nMode = mCurrentMode;
+    mReplaying = true;
+    mFoldFrames.Replay(this);
+    mReplaying = false;
+    mCurrentMode = nMode;
+}
+
+void SSDAnalyzer::FlushRepeat()
+{
+    if (mRepeatCount == 0)
+        return;
+
+    U8 nMode = mCurrentMode;
+    mCurrentMode = mRepeatCommand;
+    ShapeFrame(mRepeatStart, mRepeatEnd, FRAME_REPEAT, 0, mRepeatCount, mRepeatCommand);
+    mCurrentMode = nMode;
+    mRepeatCount = 0;
+}
+
+void SSDAnalyzer::WaitForRepeat()
+{
+    // La capture peut encore prolonger la serie: elle n'est affichee que si
+    // rien n'arrive avant l'intervalle de commit (fin de capture comprise)
+    std::chrono::steady_clock::time_point deadline = mRepeatOpened + std::chrono::milliseconds(mSettings->mCommitMs);
+    while (mDecoder.GetEdges().IsWaitingForData()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            FlushRepeat();
+            CommitFrames();
+            return;
+        }
+        CheckIfThreadShouldExit();
+        std::this_thread::sleep_for(std::chrono::milliseconds(REPEAT_POLL_MS));
+    }
+}
+
+void SSDAnalyzer::PostCompactFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2)
+{
+    switch (ft) {
+    case FRAME_PSBIT:
+    case FRAME_DSBIT:
+        // Rattache a l'octet qui suit
+        mSpanStart = nStartSample;
+        mSpanPending = true;
+        return;
+    case FRAME_PEBIT:
+        // Detecte par lookahead: largeur nulle apres le checksum
+        return;
+    case FRAME_CMDBYTE:
+    case FRAME_CARDATA:
+    case FRAME_CHECKSUM:
+        if (mSpanPending)
+            nStartSample = mSpanStart;
+        break;
+    default:
+        break;
     }
+
+    mSpanPending = false;
+    PostFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2);
 }
 
-void SSDAnalyzer::PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2)
+void SSDAnalyzer::PostPacketFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2)
+{
+    switch (ft) {
+    case FRAME_PREAMBLE:
+        mPacketStart = nStartSample;
+        mPacketPreambleBits = (U8)Data1;
+        mPacketData = 0;
+        mPacketDataCount = 0;
+        break;
+    case FRAME_CMDBYTE:
+        mPacketData = Data1 & 0xFF;
+        break;
+    case FRAME_CARDATA:
+        if (Data2 >= 1 && Data2 <= 6) {
+            mPacketData |= (Data1 & 0xFF) << (8 * Data2);
+            mPacketDataCount = (U8)Data2;
+        }
+        break;
+    case FRAME_CHECKSUM:
+        mPacketData |= (Data1 & 0xFF) << (8 * PACKET_CHECKSUM_INDEX);
+        PostFrame(mPacketStart, nEndSample, FRAME_PACKET, Flags, mPacketData,
+                  mPacketPreambleBits | ((Data2 & 0xFF) << 8) | ((U64)mPacketDataCount << 16));
+        break;
+    case FRAME_PSBIT:
+    case FRAME_DSBIT:
+    case FRAME_PEBIT:
+        break;
+    default:
+        // Les erreurs gardent leur propre frame
+        PostFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2);
+        break;
+    }
+}
+
+void SSDAnalyzer::OnProgress(U64 nSample)
+{
+    if (nSample < mNextProgress)
+        return;
+
+    ReportProgress(nSample);
+    mNextProgress = nSample + mProgressSamples;
+}
+
+template <bool bFrameV2, bool bCarDetails>
+void SSDAnalyzer::PostFrameAs(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2)
 {
     Frame frame;
     frame.mStartingSampleInclusive = nStartSample;
@@ -91,7 +319,12 @@ void SSDAnalyzer::PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8
     frame.mData2 = Data2;
     frame.mType = ft;
     frame.mFlags = Flags;
-    mResults->AddFrame(frame);
+    U64 frame_index = mResults->AddFrame(frame);
+    mResults->GetPacketTable().AddFrame(frame_index, ft, Flags, nStartSample, nEndSample, Data1, Data2);
+    mPendingFrames++;
+
+    if (!bFrameV2)
+        return;
 
     // FrameV2 for modern Saleae Logic 2 interface with consistent colors per packet
     FrameV2 framev2;
@@ -143,14 +376,16 @@ void SSDAnalyzer::PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8
         framev2.AddByte("data", (U8)Data1);
         framev2.AddByte("car_id", (U8)Data2);
 
-        // Decode car data details
-        bool braking = (Data1 & 0x80) != 0;
-        bool lane_change = (Data1 & 0x40) != 0;
-        U8 speed_power = (U8)(Data1 & 0x3F);
+        if (bCarDetails) {
+            // Decode car data details
+            bool braking = (Data1 & 0x80) != 0;
+            bool lane_change = (Data1 & 0x40) != 0;
+            U8 speed_power = (U8)(Data1 & 0x3F);
 
-        framev2.AddByte("braking", braking ? 1 : 0);
-        framev2.AddByte("lane_change", lane_change ? 1 : 0);
-        framev2.AddByte("speed_power", speed_power);
+            framev2.AddByte("braking", braking ? 1 : 0);
+            framev2.AddByte("lane_change", lane_change ? 1 : 0);
+            framev2.AddByte("speed_power", speed_power);
+        }
 
         // Utiliser la couleur du paquet actuel (coherence)
         mResults->AddFrameV2(framev2, GetCurrentPacketColor(), nStartSample, nEndSample);
@@ -161,6 +396,8 @@ void SSDAnalyzer::PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8
         framev2.AddString("type", "checksum");
         framev2.AddByte("data", (U8)Data1);
         framev2.AddByte("valid", (Flags & CHECKSUM_ERROR_FLAG) == 0 ? 1 : 0);
+        if ((Flags & RECOVERED_FLAG) != 0)
+            framev2.AddByte("recovered", 1);
 
         if ((Flags & CHECKSUM_ERROR_FLAG) != 0) {
             // ROUGE seulement pour les erreurs de checksum
@@ -172,6 +409,42 @@ void SSDAnalyzer::PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8
         }
         break;
 
+    case FRAME_PACKET:
+    {
+        U8 bytes[8];
+        for (int i = 0; i < 8; i++)
+            bytes[i] = PACKET_BYTE(Data1, i);
+
+        framev2.AddString("type", "packet");
+        framev2.AddByte("command", bytes[0]);
+        framev2.AddString("mode", (bytes[0] == SSD_MODE_RACE) ? "RACE" : (bytes[0] == SSD_MODE_PROGRAM) ? "PROGRAM" : "UNKNOWN");
+        framev2.AddByteArray("data", bytes + 1, PACKET_DATA_COUNT(Data2));
+        framev2.AddByte("checksum", bytes[PACKET_CHECKSUM_INDEX]);
+        framev2.AddByte("valid", (Flags & CHECKSUM_ERROR_FLAG) == 0 ? 1 : 0);
+        framev2.AddByte("preamble", PACKET_PREAMBLE_BITS(Data2));
+        if ((Flags & RECOVERED_FLAG) != 0)
+            framev2.AddByte("recovered", 1);
+
+        // ROUGE si le checksum est faux, sinon couleur du paquet
+        mResults->AddFrameV2(framev2, (Flags & CHECKSUM_ERROR_FLAG) != 0 ? "ssd_error" : GetCurrentPacketColor(), nStartSample, nEndSample);
+    }
+    break;
+
+    case FRAME_REPEAT:
+        framev2.AddString("type", "repeat");
+        framev2.AddByte("command", (U8)Data2);
+        framev2.AddInteger("count", (S64)Data1);
+        // Couleur du paquet repete
+        mResults->AddFrameV2(framev2, GetCurrentPacketColor(), nStartSample, nEndSample);
+        break;
+
+    case FRAME_ERR_SPAN:
+        framev2.AddString("type", "error_span");
+        framev2.AddInteger("count", (S64)Data1);
+        framev2.AddByte("flags", Flags);
+        mResults->AddFrameV2(framev2, "ssd_error", nStartSample, nEndSample);
+        break;
+
     case FRAME_PEBIT:
         framev2.AddString("type", "end_bit");
         // Couleur neutre pour la fin de paquet
@@ -184,44 +457,205 @@ void SSDAnalyzer::PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8
         mResults->AddFrameV2(framev2, "ssd_error", nStartSample, nEndSample);
         break;
     }
+}
+
+bool SSDAnalyzer::IsCommitDue(eFrameType ft)
+{
+    // Fin de paquet: PE bit, ou erreur qui renvoie la machine d'etat en INIT
+    bool bPacketEnd = (ft == FRAME_PEBIT || ft == FRAME_ERR || ft == FRAME_END_ERR || ft == FRAME_ERR_SPAN);
+
+    switch (mSettings->mCommitMode) {
+    case SSDAnalyzerEnums::COMMIT_FRAME:
+        return true;
+    case SSDAnalyzerEnums::COMMIT_PACKET:
+        return bPacketEnd;
+    default:
+        if (!bPacketEnd)
+            return false;
+        if (mPendingFrames >= (U32)mSettings->mCommitFrames)
+            return true;
+        return std::chrono::steady_clock::now() - mLastCommit >= std::chrono::milliseconds(mSettings->mCommitMs);
+    }
+}
 
+void SSDAnalyzer::CommitFrames()
+{
     mResults->CommitResults();
+    mResults->GetPacketTable().Commit();
+    mPendingFrames = 0;
+    mLastCommit = std::chrono::steady_clock::now();
+    UpdateRunStats();
+}
+
+void SSDAnalyzer::UpdateRunStats()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mRunStatsLock);
+    mDecoder.GetStats(&mRunStats.mDecoder);
+    mRunStats.mEndSample = mDecoder.GetEdges().GetSampleNumber();
+    mRunStats.mWallSeconds = std::chrono::duration<double>(now - mRunStart).count();
+
+    // Les histogrammes font 14 Ko: pas a chaque commit
+    if (mSettings->mTimingReport && now - mLastTimingUpdate >= std::chrono::milliseconds(TIMING_UPDATE_MS)) {
+        mDecoder.GetEdges().GetHistogram(&mRunStats.mTiming);
+        mRunStats.mLimits = mDecoder.GetLimits();
+        mLastTimingUpdate = now;
+    }
+}
+
+void SSDAnalyzer::PostTimingReport()
+{
+    // Le commit qui suit copie les histogrammes pour l'export
+    U64 nSample = mDecoder.GetEdges().GetSampleNumber();
+    mTimingSample = nSample;
+    mLastTimingUpdate = std::chrono::steady_clock::time_point();
+    if (!mSettings->mFrameV2 || nSample < mNextTimingReport)
+        return;
+    mNextTimingReport = nSample + mTimingReportSamples;
+
+    SSDTimingHistogram histogram;
+    SSDTimingSummary ones, zeros, gaps;
+    mDecoder.GetEdges().GetHistogram(&histogram);
+    histogram.GetSummary(mDecoder.GetLimits(), SSDTimingHistogram::POPULATION_1HBIT, &ones);
+    histogram.GetSummary(mDecoder.GetLimits(), SSDTimingHistogram::POPULATION_0HBIT, &zeros);
+    histogram.GetSummary(mDecoder.GetLimits(), SSDTimingHistogram::POPULATION_GAP, &gaps);
+
+    // Resume cumule depuis le debut, sans largeur, a la position du decodeur
+    FrameV2 framev2;
+    framev2.AddInteger("one_count", (S64)ones.mCount);
+    framev2.AddDouble("one_min_us", ones.mMin);
+    framev2.AddDouble("one_max_us", ones.mMax);
+    framev2.AddDouble("one_mean_us", ones.mMean);
+    framev2.AddDouble("one_jitter_us", ones.mJitter99);
+    framev2.AddInteger("one_outside", (S64)ones.mOutside);
+    framev2.AddInteger("zero_count", (S64)zeros.mCount);
+    framev2.AddDouble("zero_min_us", zeros.mMin);
+    framev2.AddDouble("zero_max_us", zeros.mMax);
+    framev2.AddDouble("zero_mean_us", zeros.mMean);
+    framev2.AddDouble("zero_jitter_us", zeros.mJitter99);
+    framev2.AddInteger("zero_outside", (S64)zeros.mOutside);
+    framev2.AddInteger("gap_count", (S64)gaps.mCount);
+    framev2.AddDouble("gap_min_us", gaps.mMin);
+    framev2.AddDouble("gap_mean_us", gaps.mMean);
+    mResults->AddFrameV2(framev2, "ssd_timing", nSample, nSample);
+    mPendingFrames++;
+}
+
+void SSDAnalyzer::GetRunStats(SSDRunStats* stats)
+{
+    std::lock_guard<std::mutex> lock(mRunStatsLock);
+    *stats = mRunStats;
 }
 
 void SSDAnalyzer::Setup()
 {
     // Sample Rate
     mSampleRateHz = GetSampleRate();
-    double dSamplesPerMicrosecond = (mSampleRateHz / 1000000.0);
-
-    // Use the mCalPPM setting to adjust the resolution of the measurements
-    double dMaxCorrection = 1.0 + (double)mSettings->mCalPPM / 1000000.0;
-    double dMinCorrection = 1.0 - (double)mSettings->mCalPPM / 1000000.0;
-
-    // SSD Protocol timing - TOLERANCES ELARGIES
-    // Bit 1: 57μs a 63μs par demi-bit (periode complete: 114μs a 126μs)
-    // Bit 0: 106μs a 125μs par demi-bit (periode complete: 212μs a 250μs)
-
-    mMaxBitLen = (UINT)round(500.0 * dSamplesPerMicrosecond * dMaxCorrection);  // Maximum bit length
-    mMinPEHold = (UINT)round(26.0 * dSamplesPerMicrosecond * dMinCorrection);
-    mMaxPGap = (UINT)round(30000.0 * dSamplesPerMicrosecond * dMaxCorrection);
-
-    if (mSettings->mMode == SSDAnalyzerEnums::MODE_TOLERANT) {
-        // Mode tolerant : plages encore plus larges
-        mMin1hbit = (UINT)round(55.0 * dSamplesPerMicrosecond * dMinCorrection);  // 57μs - 2μs marge
-        mMax1hbit = (UINT)round(65.0 * dSamplesPerMicrosecond * dMaxCorrection);  // 63μs + 2μs marge
-        mMin0hbit = (UINT)round(104.0 * dSamplesPerMicrosecond * dMinCorrection); // 106μs - 2μs marge
-        mMax0hbit = (UINT)round(127.0 * dSamplesPerMicrosecond * dMaxCorrection); // 125μs + 2μs marge
-    }
-    else {
-        // Mode standard : tolerances demandees
-        mMin1hbit = (UINT)round(57.0 * dSamplesPerMicrosecond * dMinCorrection);  // 57μs minimum
-        mMax1hbit = (UINT)round(63.0 * dSamplesPerMicrosecond * dMaxCorrection);  // 63μs maximum
-        mMin0hbit = (UINT)round(106.0 * dSamplesPerMicrosecond * dMinCorrection); // 106μs minimum
-        mMax0hbit = (UINT)round(125.0 * dSamplesPerMicrosecond * dMaxCorrection); // 125μs maximum
-    }
+    SetTiming(1.0);
+    mDecoder.SetPreambleBits((U32)mSettings->mPreambleBits);
+    mDecoder.SetResync(mSettings->mCoalesceErrors);
+    mDecoder.SetRecovery(mSettings->mBitRecovery);
+    mDecoder.SetOutput(this);
+
+    // Une instance de PostFrameAs par combinaison d'options
+    if (mSettings->mFrameV2)
+        mPostFrame = mSettings->mShowCarDetails ? &SSDAnalyzer::PostFrameAs<true, true> : &SSDAnalyzer::PostFrameAs<true, false>;
+    else
+        mPostFrame = &SSDAnalyzer::PostFrameAs<false, false>;
+
+    // Budgets des appels au host, en echantillons
+    mProgressSamples = (U64)mSampleRateHz * PROGRESS_INTERVAL_US / 1000000;
+    mExitCheckSamples = (U64)mSampleRateHz * EXIT_CHECK_INTERVAL_US / 1000000;
+    if (mProgressSamples == 0)
+        mProgressSamples = 1;
+    if (mExitCheckSamples == 0)
+        mExitCheckSamples = 1;
+    mNextProgress = 0;
+
+    mPendingFrames = 0;
+    mLastCommit = std::chrono::steady_clock::now();
+    mSpanPending = false;
+    mFoldFrames.Clear();
+    mFoldOpen = false;
+    mFoldDropEnd = false;
+    mRepeatCount = 0;
+    for (int i = 0; i < 256; i++)
+        mLastPacketValid[i] = false;
 
     mSSD = GetAnalyzerChannelData(mSettings->mInputChannel);
+    SSDChannelSource source(mSSD);
+    source.SetDeglitch(SSDDeglitch((U32)mSettings->mDeglitchNs, mSampleRateHz));
+    mDecoder.GetEdges().SetHistogram(mSettings->mTimingReport ? mSampleRateHz : 0);
+    mDecoder.GetEdges().Init(source, mSSD->GetSampleNumber());
+    mDecoder.Reset(mDecoder.GetEdges().GetSampleNumber());
+    mDecoder.ClearStats();
+    mTimingSample = mDecoder.GetEdges().GetSampleNumber();
+    mTimingReportSamples = (U64)mSampleRateHz * TIMING_REPORT_US / 1000000;
+    mNextTimingReport = 0;
+    mLastTimingUpdate = std::chrono::steady_clock::time_point();
+    mCalIntervals.clear();
+    mCalLong = 0;
+
+    // Le temps de la calibration compte dans le debit
+    mRunStart = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mRunStatsLock);
+    mRunStats = SSDRunStats();
+    mRunStats.mSampleRateHz = mSampleRateHz;
+    mRunStats.mThreads = (mSettings->mDecoderThreads > 1 && !mDecoder.IsTracking()) ? (U32)mSettings->mDecoderThreads : 1;
+    mRunStats.mStartSample = mDecoder.GetEdges().GetSampleNumber();
+    mRunStats.mEndSample = mRunStats.mStartSample;
+    mDecoder.GetEdges().GetHistogram(&mRunStats.mTiming);
+    mRunStats.mLimits = mDecoder.GetLimits();
+}
+
+void SSDAnalyzer::SetTiming(double dSkew)
+{
+    // Adaptive: fenetres standard au depart, suivies dans les limites du mode tolerant
+    mDecoder.SetTiming(mSampleRateHz, mSettings->mMode == SSDAnalyzerEnums::MODE_TOLERANT, mSettings->mCalPPM, dSkew);
+    mDecoder.SetTracking(mSettings->mMode == SSDAnalyzerEnums::MODE_ADAPTIVE,
+                         SSDDecoderBase::GetTimingLimits(mSampleRateHz, true, mSettings->mCalPPM, dSkew));
+}
+
+void SSDAnalyzer::Calibrate()
+{
+    // Pre-pass over the first edges, then the decoder reads them back from
+    // mCalIntervals and goes on with the channel: nothing is lost
+    U64 nStartSample = mDecoder.GetEdges().GetSampleNumber();
+    U64 nLast = nStartSample;
+    SSDCalibration calibration(mSampleRateHz);
+    SSDDeglitch deglitch = mDecoder.GetEdges().GetSource().GetDeglitch();
+
+    while (mCalIntervals.size() < SSD_CALIBRATION_EDGES) {
+        // Capture courte ou en cours: ce qu'il y a suffit, sinon on attend
+        if (mCalIntervals.size() >= CALIBRATION_MIN_EDGES && !mSSD->DoMoreTransitionsExistInCurrentData())
+            break;
+        if ((mCalIntervals.size() & 255) == 255)
+            CheckIfThreadShouldExit();
+
+        mSSD->AdvanceToNextEdge();
+        U64 nInterval;
+        bool bReady = deglitch.Push(mSSD->GetSampleNumber() - nLast, &nInterval);
+        nLast = mSSD->GetSampleNumber();
+        if (!bReady)
+            continue;
+        calibration.AddInterval(nInterval);
+
+        if (nInterval >= INTERVAL_LONG) {
+            mCalLong = nInterval;
+            mCalIntervals.push_back(INTERVAL_LONG);
+            break;
+        }
+        mCalIntervals.push_back((U32)nInterval);
+    }
+
+    // Pas assez de preambules: fenetres nominales
+    if (calibration.Compute())
+        SetTiming(calibration.GetSkew());
+
+    SSDMemorySource memory(mCalIntervals.data(), mCalIntervals.size(), &mCalLong);
+    SSDChannelSource source(memory, mSSD);
+    source.SetDeglitch(deglitch);
+    mDecoder.GetEdges().Init(source, nStartSample);
 }
 
 void SSDAnalyzer::DecodeCarData(U8 carData, char* buffer, int bufferSize)
@@ -243,316 +677,49 @@ void SSDAnalyzer::DecodeCarData(U8 carData, char* buffer, int bufferSize)
 void SSDAnalyzer::WorkerThread()
 {
     Setup();
-    U32 nHBitCnt = 0;
-    U8  nHBitVal = 0;
-    U32 nBits = 0;
-    U8  nVal = 0;
-    U8  nChecksum = 0;
-    eFrameState ef = FSTATE_INIT;
-    U64 nFrameStart = mSSD->GetSampleNumber();
-    U64 nCurSample = nFrameStart;
-    U64 nPreambleStart = 0;
-    U64 nBitStartSample = 0;
-    U64 nTemp = nCurSample;
-
-    // SSD specific variables
-    mCurrentMode = 0;
-    mCarCount = 0;
-    mCalculatedChecksum = 0;
-
-    for (;;) {
-        nBitStartSample = nCurSample;
-
-        switch (ef)
-        {
-        case FSTATE_INIT:
-            nHBitVal = GetNextHBit(&nCurSample);
-            switch (nHBitVal)
-            {
-            case 1:
-                ++nHBitCnt;
-                if (nHBitCnt == ((U32)mSettings->mPreambleBits * 2)) {
-                    ef = FSTATE_PREAMBLE;
-                }
-                break;
-            default:
-                nHBitCnt = 0;
-                nFrameStart = nCurSample + 1;
-                nPreambleStart = nFrameStart;
-                break;
-            }
-            break;
-
-        case FSTATE_PREAMBLE:
-            nTemp = nCurSample;
-            nHBitVal = LookaheadNextHBit(&nTemp);
-            switch (nHBitVal) {
-            case 0: // Start bit ends preamble
-                PostFrame(nPreambleStart, nCurSample, FRAME_PREAMBLE, 0, nHBitCnt / 2, 0);
-                ReportProgress(nCurSample);
-                nFrameStart = nCurSample + 1;
-                ef = FSTATE_PSBIT;
-                break;
-            case 1:
-                nHBitVal = GetNextHBit(&nCurSample);
-                ++nHBitCnt;
-                break;
-            default:
-                PostFrame(nBitStartSample, nCurSample, FRAME_ERR, nHBitVal, 0, 0);
-                mResults->AddMarker(nBitStartSample, AnalyzerResults::ErrorSquare, mSettings->mInputChannel);
-                mResults->AddMarker(nCurSample, AnalyzerResults::ErrorX, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nHBitCnt = 0;
-                ef = FSTATE_INIT;
-            }
-            break;
-
-        case FSTATE_PSBIT:
-            nHBitVal = GetNextBit(&nCurSample);
-            nHBitCnt = 0;
-            if (nHBitVal == 0) { // Packet start bit
-                PostFrame(nFrameStart, nCurSample, FRAME_PSBIT, 0, 0, 0);
-                mResults->AddMarker(nFrameStart, AnalyzerResults::Start, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nBits = nVal = 0;
-                // CORRECTION CHECKSUM: Initialiser a 0xFF selon le protocole SSD reel
-                mCalculatedChecksum = 0xFF;
-                nFrameStart = nCurSample + 1;
-                ef = FSTATE_CMDBYTE;
-            }
-            else {
-                PostFrame(nBitStartSample, nCurSample, FRAME_ERR, FRAMING_ERROR_FLAG, 0, 0);
-                mResults->AddMarker(nBitStartSample, AnalyzerResults::ErrorDot, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nHBitCnt = 0;
-                ef = FSTATE_INIT;
-            }
-            break;
-
-        case FSTATE_CMDBYTE:
-            switch (nHBitVal = GetNextBit(&nCurSample))
-            {
-            case 0:
-            case 1:
-                nVal <<= 1;
-                nVal |= nHBitVal;
-                nBits++;
-                if (nBits == 8)
-                {
-                    mCurrentMode = nVal;  // Definir le mode pour tout le paquet
-                    mCarCount = 0;  // Reset car count for new packet
-
-                    // CORRECTION CHECKSUM CRITIQUE: Inclure la commande dans le checksum
-                    mCalculatedChecksum ^= nVal;
-
-                    PostFrame(nFrameStart, nCurSample, FRAME_CMDBYTE, 0, nVal, 0);
-                    ReportProgress(nCurSample);
-                    nFrameStart = nCurSample + 1;
-                    ef = FSTATE_DSBIT;
-                    nBits = nVal = 0;
-                }
-                break;
-            default:
-                PostFrame(nBitStartSample, nCurSample, FRAME_ERR, nHBitVal, 0, 0);
-                mResults->AddMarker(nBitStartSample, AnalyzerResults::ErrorSquare, mSettings->mInputChannel);
-                mResults->AddMarker(nCurSample, AnalyzerResults::ErrorX, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nHBitCnt = 0;
-                ef = FSTATE_INIT;
-            }
-            break;
-
-        case FSTATE_DSBIT:
-            nHBitVal = GetNextBit(&nCurSample);
-            if (nHBitVal == 0) { // Data start bit
-                PostFrame(nFrameStart, nCurSample, FRAME_DSBIT, 0, 0, 0);
-                mResults->AddMarker(nFrameStart, AnalyzerResults::Start, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nBits = nVal = 0;
-                nFrameStart = nCurSample + 1;
-                ef = FSTATE_DATABYTE;
-            }
-            else {
-                PostFrame(nBitStartSample, nCurSample, FRAME_ERR, FRAMING_ERROR_FLAG, 0, 0);
-                mResults->AddMarker(nBitStartSample, AnalyzerResults::ErrorDot, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nHBitCnt = 0;
-                ef = FSTATE_INIT;
-            }
-            break;
-
-        case FSTATE_DATABYTE:
-            switch (nHBitVal = GetNextBit(&nCurSample))
-            {
-            case 0:
-            case 1:
-                nVal <<= 1;
-                nVal |= nHBitVal;
-                nBits++;
-                if (nBits == 8)
-                {
-                    // Store the car data byte
-                    if (mCarCount < 6) {  // Protection contre debordement
-                        mCarData[mCarCount] = nVal;
-                    }
-
-                    // Continuer a XOR avec les donnees voitures
-                    mCalculatedChecksum ^= nVal;
-
-                    // Afficher les donnees avec le numero de voiture correct (1-6)
-                    U8 carNumber = mCarCount + 1;
-                    PostFrame(nFrameStart, nCurSample, FRAME_CARDATA, 0, nVal, carNumber);
-
-                    // CORRECTION IMPORTANTE: Les deux modes (RACE et PROGRAM) ont 6 bytes de donnees
-                    bool isLastByte = false;
-
-                    if (mCurrentMode == SSD_MODE_RACE) {
-                        // En mode RACE, on attend exactement 6 voitures (mCarCount 0-5)
-                        isLastByte = (mCarCount >= 5);
-                    }
-                    else if (mCurrentMode == SSD_MODE_PROGRAM) {
-                        // CORRECTION: En mode PROGRAM, on attend exactement 6 bytes (mCarCount 0-5)
-                        isLastByte = (mCarCount >= 5);  // ETAIT 3, MAINTENANT 5
-                    }
-                    else {
-                        // Mode inconnu - supposer que c'est le checksum apres ce byte
-                        isLastByte = true;
-                    }
-
-                    // Incrementer le compteur de voitures APRES l'avoir utilise
-                    mCarCount++;
-
-                    // CORRECTION PRINCIPALE: Toujours passer par un etat DSBIT
-                    // car il y a TOUJOURS un bit start avant le prochain byte (donnees ou checksum)
-                    ReportProgress(nCurSample);
-                    nFrameStart = nCurSample + 1;
-                    nBits = nVal = 0;
-
-                    if (isLastByte) {
-                        // Prochain byte sera le checksum, mais il faut d'abord lire son bit start
-                        ef = FSTATE_DSBIT_CHECKSUM;  // Nouvel etat pour differencier
-                    }
-                    else {
-                        // Plus de bytes de donnees a suivre
-                        ef = FSTATE_DSBIT;
-                    }
-                }
-                break;
-            default:
-                PostFrame(nBitStartSample, nCurSample, FRAME_ERR, nHBitVal, 0, 0);
-                mResults->AddMarker(nBitStartSample, AnalyzerResults::ErrorSquare, mSettings->mInputChannel);
-                mResults->AddMarker(nCurSample, AnalyzerResults::ErrorX, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nHBitCnt = 0;
-                ef = FSTATE_INIT;
-            }
-            break;
-
-        case FSTATE_DSBIT_CHECKSUM:
-            nHBitVal = GetNextBit(&nCurSample);
-            if (nHBitVal == 0) { // Data start bit avant checksum
-                PostFrame(nFrameStart, nCurSample, FRAME_DSBIT, 0, 0, 0);
-                mResults->AddMarker(nFrameStart, AnalyzerResults::Start, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nBits = nVal = 0;
-                nFrameStart = nCurSample + 1;
-                ef = FSTATE_CHECKSUM;  // Maintenant on peut lire le checksum
-            }
-            else {
-                PostFrame(nBitStartSample, nCurSample, FRAME_ERR, FRAMING_ERROR_FLAG, 0, 0);
-                mResults->AddMarker(nBitStartSample, AnalyzerResults::ErrorDot, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nHBitCnt = 0;
-                ef = FSTATE_INIT;
-            }
-            break;
+    if (mSettings->mAutoCalibration)
+        Calibrate();
+
+    // Ce qui est deja capture est decode par tranches sur plusieurs threads,
+    // la suite (capture en cours) en serie. Le suivi de derive depend de tout
+    // ce qui precede une tranche: toujours en serie.
+    if (mSettings->mDecoderThreads > 1 && !mDecoder.IsTracking()) {
+        mParallel.Init(mSettings->mDecoderThreads, mDecoder.GetEdges().GetSampleNumber(),
+                       mCalIntervals.data(), (U32)mCalIntervals.size(), mCalLong);
+        mParallel.SetDeglitch(mDecoder.GetEdges().GetSource().GetDeglitch());
+        while (mParallel.DecodeBatch(mDecoder, mSSD)) {
+            if (mPendingFrames != 0)
+                CommitFrames();
+            CheckIfThreadShouldExit();
+        }
+    }
 
-        case FSTATE_CHECKSUM:
-            switch (nHBitVal = GetNextBit(&nCurSample))
-            {
-            case 0:
-            case 1:
-                nVal <<= 1;
-                nVal |= nHBitVal;
-                nBits++;
-                if (nBits == 8)
-                {
-                    U8 flags = 0;
-
-                    // Comparer le checksum recu avec le checksum calcule
-                    // Le checksum calcule inclut: 0xFF ⊕ Commande ⊕ Donnees voitures
-                    if (nVal != mCalculatedChecksum) {
-                        flags |= CHECKSUM_ERROR_FLAG;
-                        mResults->AddMarker(nFrameStart, AnalyzerResults::ErrorX, mSettings->mInputChannel);
-                    }
-
-                    PostFrame(nFrameStart, nCurSample, FRAME_CHECKSUM, flags, nVal, mCalculatedChecksum);
-                    ReportProgress(nCurSample);
-                    nFrameStart = nCurSample + 1;
-                    ef = FSTATE_PEBIT;
-                    nBits = nVal = 0;
-                }
-                break;
-            default:
-                PostFrame(nBitStartSample, nCurSample, FRAME_ERR, nHBitVal, 0, 0);
-                mResults->AddMarker(nBitStartSample, AnalyzerResults::ErrorSquare, mSettings->mInputChannel);
-                mResults->AddMarker(nCurSample, AnalyzerResults::ErrorX, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nHBitCnt = 0;
-                ef = FSTATE_INIT;
-            }
-            break;
+    U32 nSteps = 0;
+    U64 nNextExitCheck = mDecoder.GetEdges().GetSampleNumber() + mExitCheckSamples;
 
-        case FSTATE_PEBIT:
-        {
-            // Bloc pour isoler la portee de la variable lookahead
-            // Apres le checksum, chercher le gap entre paquets ou le debut du prochain
-            nTemp = nCurSample;
-            UINT lookahead = LookaheadNextHBit(&nTemp);
-
-            if (lookahead == 3) {
-                // Packet gap detecte - fin normale de paquet
-                PostFrame(nFrameStart, nCurSample, FRAME_PEBIT, 0, 0, 0);
-                mResults->AddMarker(nFrameStart, AnalyzerResults::Stop, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-
-                // Avancer jusqu'a la fin du gap
-                while (LookaheadNextHBit(&nCurSample) == 3) {
-                    GetNextHBit(&nCurSample);
-                }
-
-                nFrameStart = nCurSample + 1;
-                nPreambleStart = nFrameStart;
-                nHBitCnt = 0;
-                ef = FSTATE_INIT;
-            }
-            else if (lookahead == 1) {
-                // Debut immediat du prochain paquet (preamble)
-                PostFrame(nFrameStart, nCurSample, FRAME_PEBIT, 0, 0, 0);
-                mResults->AddMarker(nFrameStart, AnalyzerResults::Stop, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-
-                nFrameStart = nCurSample + 1;
-                nPreambleStart = nFrameStart;
-                nHBitCnt = 1; // On a deja vu le premier bit '1' du preambule
-                ef = FSTATE_INIT;
-            }
-            else {
-                // Erreur ou bit inattendu
-                PostFrame(nFrameStart, nCurSample, FRAME_ERR, BIT_ERROR_FLAG, 0, 0);
-                mResults->AddMarker(nFrameStart, AnalyzerResults::ErrorX, mSettings->mInputChannel);
-                ReportProgress(nCurSample);
-                nHBitCnt = 0;
-                ef = FSTATE_INIT;
-            }
+    for (;;) {
+        // Rien ne doit rester en attente pendant que le canal attend des donnees,
+        // sauf une serie "repeat xN" recente
+        if ((mPendingFrames != 0 || mDecoder.HasErrorSpan() ||
+             (mSettings->mTimingReport && mTimingSample != mDecoder.GetEdges().GetSampleNumber())) &&
+            mDecoder.GetEdges().IsWaitingForData()) {
+            mDecoder.FlushErrors();
+            if (mSettings->mTimingReport)
+                PostTimingReport();
+            CommitFrames();
+            CheckIfThreadShouldExit();
         }
-        break;
+        if (mRepeatCount != 0 && mDecoder.GetEdges().IsWaitingForData())
+            WaitForRepeat();
 
-        default:
-            nHBitCnt = 0;
-            ef = FSTATE_INIT;
+        mDecoder.Step();
+
+        // Pas d'appel au host a chaque demi-bit de preambule
+        if (++nSteps >= EXIT_CHECK_STEPS || mDecoder.GetEdges().GetSampleNumber() >= nNextExitCheck) {
+            CheckIfThreadShouldExit();
+            nSteps = 0;
+            nNextExitCheck = mDecoder.GetEdges().GetSampleNumber() + mExitCheckSamples;
         }
-        CheckIfThreadShouldExit();
     }
 }
 
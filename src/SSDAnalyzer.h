@@ -2,29 +2,23 @@
 #define SSD_ANALYZER_H
 
 #include <Analyzer.h>
+#include <chrono>
+#include <mutex>
 #include "SSDAnalyzerResults.h"
 #include "SSDSimulationDataGenerator.h"
+#include "SSDParallelDecoder.h"
 
-typedef unsigned int UINT;
-
-// SSD Protocol constants
-#define SSD_MODE_PROGRAM 0x01
-#define SSD_MODE_RACE    0x02
-
-enum eFrameState {
-    FSTATE_INIT,
-    FSTATE_PREAMBLE,
-    FSTATE_PSBIT,
-    FSTATE_CMDBYTE,
-    FSTATE_DSBIT,
-    FSTATE_DSBIT_CHECKSUM,  // Bit start avant checksum
-    FSTATE_DATABYTE,
-    FSTATE_CHECKSUM,
-    FSTATE_PEBIT
-};
+// Host call budgets, in capture time and decoder steps
+#define PROGRESS_INTERVAL_US    10000   // ReportProgress au plus toutes les 10 ms de capture
+#define EXIT_CHECK_INTERVAL_US  1000    // CheckIfThreadShouldExit toutes les 1 ms de capture...
+#define EXIT_CHECK_STEPS        4096    // ... ou tous les 4096 pas de la machine d'etat
+#define REPEAT_POLL_MS          5       // Attente de donnees avec une serie "repeat xN" ouverte
+#define CALIBRATION_MIN_EDGES   256     // Pre-passe: n'attend pas plus de donnees au-dela
+#define TIMING_REPORT_US        1000000 // FrameV2 "ssd_timing" au plus toutes les secondes de capture
+#define TIMING_UPDATE_MS        250     // Copie des histogrammes pour l'export, hors attente de donnees
 
 class SSDAnalyzerSettings;
-class ANALYZER_EXPORT SSDAnalyzer : public Analyzer2
+class ANALYZER_EXPORT SSDAnalyzer : public Analyzer2, public SSDDecoderOutput
 {
 public:
     SSDAnalyzer();
@@ -39,35 +33,103 @@ public:
     virtual const char* GetAnalyzerName() const;
     virtual bool NeedsRerun();
 
+    // SSDDecoderOutput
+    virtual void OnFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2, U8 nPacketMode);
+    virtual void OnMarker(U64 nSample, eMarkerType marker);
+    virtual void OnProgress(U64 nSample);
+
     // Helper functions
     void Setup();
-    UINT LookaheadNextHBit(U64* nSample);
-    UINT GetNextHBit(U64* nSample);
-    UINT GetNextBit(U64* nSample);
-    void PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2);
+    void SetTiming(double dSkew);
+    void Calibrate();
+    void PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2)
+    {
+        (this->*mPostFrame)(nStartSample, nEndSample, ft, Flags, Data1, Data2);
+    }
+    template <bool bFrameV2, bool bCarDetails>
+    void PostFrameAs(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2);
+    void ShapeFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2);
+    void ShapeMarker(U64 nSample, eMarkerType marker);
+    void FoldFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2);
+    void ReplayPacket();
+    void FlushRepeat();
+    void WaitForRepeat();
+    void PostCompactFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2);
+    void PostPacketFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2);
+    bool IsCommitDue(eFrameType ft);
+    void CommitFrames();
     void DecodeCarData(U8 carData, char* buffer, int bufferSize);
     const char* GetCurrentPacketColor();
 
+    // Counters of the run, as of the last commit (stats export)
+    void GetRunStats(SSDRunStats* stats);
+    void UpdateRunStats();
+    void PostTimingReport();
+
 protected: //vars
     std::unique_ptr<SSDAnalyzerSettings> mSettings;
     std::unique_ptr<SSDAnalyzerResults> mResults;
     AnalyzerChannelData* mSSD;
+    SSDChannelDecoder mDecoder;   // Protocol state machine reading mSSD
+    SSDParallelDecoder mParallel;
 
     SSDSimulationDataGenerator mSimulationDataGenerator;
     bool mSimulationInitilized;
 
     // Timing parameters
     U32 mSampleRateHz;
-    UINT mMin1hbit, mMax1hbit;    // Bit 1 half-bit timing
-    UINT mMin0hbit, mMax0hbit;    // Bit 0 half-bit timing
-    UINT mMaxBitLen;              // Maximum bit length
-    UINT mMinPEHold, mMaxPGap;    // Packet end hold and gap timing
-
-    // SSD protocol state - RACE et PROGRAM ont tous les deux 6 bytes de donnees
-    U8 mCurrentMode;              // Current packet mode (RACE/PROGRAM)
-    U8 mCarCount;                 // Current car being processed (0-5 pour 6 bytes)
-    U8 mCalculatedChecksum;       // Calculated checksum (starts at 0xFF)
-    U8 mCarData[6];              // Car data storage (6 bytes pour RACE et PROGRAM)
+    U64 mProgressSamples;         // PROGRESS_INTERVAL_US in samples
+    U64 mExitCheckSamples;        // EXIT_CHECK_INTERVAL_US in samples
+    U64 mNextProgress;            // First sample worth a new ReportProgress()
+
+    // Auto calibration pre-pass (mSettings->mAutoCalibration): edges read
+    // from mSSD before decoding, given back to the decoder as a memory prefix
+    std::vector<U32> mCalIntervals;
+    U64 mCalLong;                 // Value behind a last INTERVAL_LONG entry
+
+    // PostFrameAs<> instance for mSettings->mFrameV2 / mShowCarDetails, picked by Setup()
+    typedef void (SSDAnalyzer::*PostFrameFn)(U64, U64, eFrameType, U8, U64, U64);
+    PostFrameFn mPostFrame;
+
+    U8 mCurrentMode;              // Mode of the packet the frame being posted belongs to
+
+    // Frame modes (mSettings->mFrameMode)
+    U64 mSpanStart;               // Compact: start of the start bit merged into the next byte
+    bool mSpanPending;
+    U64 mPacketStart;             // Packet: preamble start of the packet being assembled
+    U64 mPacketData;              // Packet: bytes so far, as in FRAME_PACKET Data1
+    U8 mPacketPreambleBits;
+    U8 mPacketDataCount;
+
+    // Repeated packet folding (mSettings->mFoldRepeats)
+    SSDBufferedOutput mFoldFrames;  // Frames and markers of the packet being decoded
+    bool mFoldOpen;               // A packet is being buffered
+    bool mFoldDropEnd;            // Last packet was folded: drop its PE bit and Stop marker
+    bool mReplaying;
+    U64 mFoldStart;
+    U64 mFoldData;                // Bytes as in FRAME_PACKET Data1
+    U64 mLastPacket[256];         // Last full packet of each command
+    bool mLastPacketValid[256];
+    U64 mRepeatCount;             // Open run of folded packets
+    U64 mRepeatStart, mRepeatEnd;
+    U8 mRepeatCommand;
+    std::chrono::steady_clock::time_point mRepeatOpened;  // Not displayed since then
+
+    // Commit policy (mSettings->mCommitMode)
+    U32 mPendingFrames;           // Frames added since the last CommitResults()
+    std::chrono::steady_clock::time_point mLastCommit;
+
+    // Stats export: copied from mDecoder at each commit, read by the export thread
+    std::mutex mRunStatsLock;
+    SSDRunStats mRunStats;
+    std::chrono::steady_clock::time_point mRunStart;
+
+    // Timing report (mSettings->mTimingReport): histograms copied to
+    // mRunStats and summed up in a FrameV2 when the decoder waits for data
+    std::chrono::steady_clock::time_point mLastTimingUpdate;
+    U64 mTimingSample;            // Decoder position at the last PostTimingReport()
+    U64 mTimingReportSamples;     // TIMING_REPORT_US in samples
+    U64 mNextTimingReport;        // First sample worth a new FrameV2
 };
 
 extern "C" ANALYZER_EXPORT const char* GetAnalyzerName();
@@ -2,9 +2,10 @@
 #include <AnalyzerHelpers.h>
 #include "SSDAnalyzer.h"
 #include "SSDAnalyzerSettings.h"
-#include <iostream>
-#include <sstream>
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
 
 SSDAnalyzerResults::SSDAnalyzerResults(SSDAnalyzer *analyzer, SSDAnalyzerSettings *settings)
     :   AnalyzerResults(),
@@ -46,6 +47,30 @@ void SSDAnalyzerResults::DecodeCarData(U8 carData, char* buffer, int bufferSize)
     }
 }
 
+void SSDAnalyzerResults::FormatPacket(U64 data, U64 info, U8 flags, bool bDetails, bool bCommand, char* buffer, int bufferSize)
+{
+    // data, info: FRAME_PACKET Data1 et Data2
+    // bCommand: false si l'appelant affiche deja le nom de la commande
+    char detail_str[64];
+    U8 count = PACKET_DATA_COUNT(info);
+
+    int len = snprintf(buffer, bufferSize, "%s", bCommand ? GetCommandName(PACKET_BYTE(data, 0)) : "");
+    for (U8 i = 1; i <= count && len < bufferSize; i++) {
+        U8 car = PACKET_BYTE(data, i);
+        if (bDetails) {
+            DecodeCarData(car, detail_str, sizeof(detail_str));
+            len += snprintf(buffer + len, bufferSize - len, " | Car%d: %s", i, detail_str);
+        } else {
+            len += snprintf(buffer + len, bufferSize - len, " %02X", car);
+        }
+    }
+    if (len < bufferSize) {
+        snprintf(buffer + len, bufferSize - len, " | CHK %02X %s%s", PACKET_BYTE(data, PACKET_CHECKSUM_INDEX),
+                ((flags & CHECKSUM_ERROR_FLAG) != 0) ? "ERR" : "OK",
+                ((flags & RECOVERED_FLAG) != 0) ? " (recovered)" : "");
+    }
+}
+
 void SSDAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel & /*channel*/, DisplayBase display_base)
 {
     ClearResultStrings();
@@ -58,6 +83,7 @@ void SSDAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel & /*channel
 
     char result_str[128];
     char detail_str[64];
+    char packet_str[256];
     
     switch ((eFrameType)frame.mType)
     {
@@ -111,7 +137,8 @@ void SSDAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel & /*channel
         } else {
             AddResultString("✓");
             AddResultString("CHK OK");
-            snprintf(result_str, sizeof(result_str), "Checksum OK: %#02llx", frame.mData1);
+            snprintf(result_str, sizeof(result_str), "Checksum OK: %#02llx%s", frame.mData1,
+                    ((frame.mFlags & RECOVERED_FLAG) != 0) ? " (1 bit recovered)" : "");
         }
         AddResultString(result_str);
         break;
@@ -122,6 +149,32 @@ void SSDAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel & /*channel
         AddResultString("Packet End");
         break;
         
+    case FRAME_PACKET:
+        AddResultString(checksum_error ? "X" : "K");
+        snprintf(result_str, sizeof(result_str), "%s %s", GetCommandName(PACKET_BYTE(frame.mData1, 0)),
+                checksum_error ? "CHK ERR" : "CHK OK");
+        AddResultString(result_str);
+        FormatPacket(frame.mData1, frame.mData2, frame.mFlags, mSettings->mShowCarDetails, true, packet_str, sizeof(packet_str));
+        AddResultString(packet_str);
+        break;
+        
+    case FRAME_REPEAT:
+        AddResultString("R");
+        snprintf(result_str, sizeof(result_str), "x%llu", frame.mData1);
+        AddResultString(result_str);
+        snprintf(result_str, sizeof(result_str), "%s x%llu (unchanged)", GetCommandName((U8)frame.mData2), frame.mData1);
+        AddResultString(result_str);
+        break;
+        
+    case FRAME_ERR_SPAN:
+        AddResultString("X");
+        snprintf(result_str, sizeof(result_str), "ERR x%llu", frame.mData1);
+        AddResultString(result_str);
+        snprintf(result_str, sizeof(result_str), "%llu Errors (%s%s%s)", frame.mData1,
+                bit_error ? "B" : "", framing_error ? "F" : "", packet_error ? "P" : "");
+        AddResultString(result_str);
+        break;
+        
     case FRAME_ERR:
     default:
         AddResultString("X");
@@ -137,91 +190,318 @@ void SSDAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel & /*channel
     }
 }
 
-void SSDAnalyzerResults::GenerateExportFile(const char *file, DisplayBase display_base, U32 /*export_type_user_id*/)
+void SSDAnalyzerResults::GenerateExportFile(const char *file, DisplayBase display_base, U32 export_type_user_id)
 {
-    std::stringstream ss;
+    if (export_type_user_id == SSDAnalyzerEnums::EXPORT_STATS || export_type_user_id == SSDAnalyzerEnums::EXPORT_TIMING) {
+        GenerateStatsFile(file, export_type_user_id == SSDAnalyzerEnums::EXPORT_TIMING);
+        return;
+    }
+    if (export_type_user_id == SSDAnalyzerEnums::EXPORT_PACKETS || export_type_user_id == SSDAnalyzerEnums::EXPORT_COLUMNS) {
+        GeneratePacketFile(file, display_base, export_type_user_id == SSDAnalyzerEnums::EXPORT_COLUMNS);
+        return;
+    }
 
+    // Les frames sont lues et le fichier ecrit sur ce thread (SDK). Chaque
+    // tour, EXPORT_SHARD_FRAMES frames par thread sont formatees en parallele
+    // pendant que le texte du tour precedent est ecrit, dans l'ordre.
     U64 trigger_sample = mAnalyzer->GetTriggerSample();
     U32 sample_rate = mAnalyzer->GetSampleRate();
     U64 num_frames = GetNumFrames();
 
-    void *f = AnalyzerHelpers::StartFile(file);
+    // Les autres bases passent par GetNumberString: formatees ici, sans worker
+    U32 num_threads = 1;
+    if (display_base == Decimal || display_base == Hexadecimal) {
+        num_threads = std::thread::hardware_concurrency();
+        num_threads = (num_threads < 1) ? 1 : (num_threads > EXPORT_MAX_THREADS) ? EXPORT_MAX_THREADS : num_threads;
+    }
 
-    ss << "Time [s],Type,Data,Hex,Details" << std::endl;
+    std::vector<ExportShard> shards(2 * num_threads);
+    ExportShard *formatting = &shards[0];
+    ExportShard *writing = &shards[num_threads];
+    U64 next_frame = 0;
+    U64 written_frames = 0;
+    bool cancelled = false;
 
-    for (U32 i = 0; i < num_frames; i++) {
-        Frame frame = GetFrame(i);
+    void *f = AnalyzerHelpers::StartFile(file);
+    const char *header = "Time [s],Type,Data,Hex,Details\n";
+    AnalyzerHelpers::AppendToFile((const U8 *)header, (U32)strlen(header), f);
 
-        char time_str[128];
-        AnalyzerHelpers::GetTimeString(frame.mStartingSampleInclusive, trigger_sample, sample_rate, time_str, 128);
+    for (U32 k = 0; k < num_threads; k++) {
+        for (U64 end = std::min(next_frame + EXPORT_SHARD_FRAMES, num_frames); next_frame < end; next_frame++)
+            formatting[k].mFrames.push_back(GetFrame(next_frame));
+    }
 
-        char number_str[128];
-        AnalyzerHelpers::GetNumberString(frame.mData1, display_base, 8, number_str, 128);
-
-        ss << time_str << ",";
-
-        switch ((eFrameType)frame.mType) {
-        case FRAME_PREAMBLE:
-            ss << "PREAMBLE," << frame.mData1 << "," << number_str << ",Preamble bits";
-            break;
-        case FRAME_PSBIT:
-            ss << "START_BIT,0,0x00,Packet start";
-            break;
-        case FRAME_CMDBYTE:
-            ss << "COMMAND," << frame.mData1 << "," << number_str << "," << GetCommandName((U8)frame.mData1);
-            break;
-        case FRAME_DSBIT:
-            ss << "START_BIT,0,0x00,Data start";
-            break;
-        case FRAME_CARDATA:
-            {
-                char detail_str[64];
-                DecodeCarData((U8)frame.mData1, detail_str, sizeof(detail_str));
-                ss << "CAR_DATA," << frame.mData1 << "," << number_str << ",Car" << frame.mData2 << ": " << detail_str;
-            }
-            break;
-        case FRAME_CHECKSUM:
-            ss << "CHECKSUM," << frame.mData1 << "," << number_str;
-            if ((frame.mFlags & CHECKSUM_ERROR_FLAG) != 0) {
-                ss << ",Checksum ERROR";
-            } else {
-                ss << ",Checksum OK";
+    // Un tour de plus pour ecrire le dernier texte
+    while ((!formatting[0].mFrames.empty() || !writing[0].mText.empty()) && !cancelled) {
+        std::vector<std::thread> threads;
+        for (U32 k = 0; k < num_threads; k++)
+            formatting[k].mDone = false;
+        for (U32 k = 0; k < num_threads && num_threads > 1 && !formatting[k].mFrames.empty(); k++) {
+            try {
+                threads.push_back(std::thread(&SSDAnalyzerResults::FormatShard, this, &formatting[k],
+                                              trigger_sample, sample_rate, display_base));
             }
-            break;
-        case FRAME_PEBIT:
-            ss << "END_BIT,0,0x00,Packet end";
-            break;
-        default:
-            ss << "ERROR,0,0x00,";
-            if ((frame.mFlags & BIT_ERROR_FLAG) != 0) {
-                ss << "Bit timing error";
-            } else if ((frame.mFlags & FRAMING_ERROR_FLAG) != 0) {
-                ss << "Framing error";
-            } else {
-                ss << "Protocol error";
+            catch (...) {
+                break;      // Shards not started are formatted after the join
             }
-            break;
         }
 
-        ss << std::endl;
+        // Tour precedent, puis les frames du suivant
+        for (U32 k = 0; k < num_threads && !cancelled; k++) {
+            if (writing[k].mText.empty())
+                continue;
+            AnalyzerHelpers::AppendToFile((const U8 *)writing[k].mText.data(), (U32)writing[k].mText.length(), f);
+            written_frames += writing[k].mFrames.size();
+            writing[k].mText.clear();
+            cancelled = UpdateExportProgressAndCheckForCancel(written_frames, num_frames);
+        }
+        for (U32 k = 0; k < num_threads && !cancelled; k++) {
+            writing[k].mFrames.clear();
+            for (U64 end = std::min(next_frame + EXPORT_SHARD_FRAMES, num_frames); next_frame < end; next_frame++)
+                writing[k].mFrames.push_back(GetFrame(next_frame));
+        }
+
+        for (size_t t = 0; t < threads.size(); t++)
+            threads[t].join();
+        for (U32 k = 0; k < num_threads && !cancelled; k++) {
+            if (!formatting[k].mDone && !formatting[k].mFrames.empty())
+                FormatShard(&formatting[k], trigger_sample, sample_rate, display_base);
+        }
+        std::swap(formatting, writing);
+    }
+
+    if (!cancelled)
+        UpdateExportProgressAndCheckForCancel(num_frames, num_frames);
+    AnalyzerHelpers::EndFile(f);
+}
+
+void SSDAnalyzerResults::FormatShard(ExportShard *shard, U64 trigger_sample, U32 sample_rate, DisplayBase display_base)
+{
+    // Runs on a worker thread: nothing here may reach the SDK
+    try {
+        SSDExportWriter out(&WriteToText, &shard->mText);
+        for (size_t i = 0; i < shard->mFrames.size(); i++)
+            WriteFrameRow(out, shard->mFrames[i], trigger_sample, sample_rate, display_base);
+        out.Flush();
+        shard->mDone = true;
+    }
+    catch (...) {
+        shard->mText.clear();
+        shard->mDone = false;
+    }
+}
+
+void SSDAnalyzerResults::WriteFrameRow(SSDExportWriter &out, const Frame &frame, U64 trigger_sample, U32 sample_rate,
+                                       DisplayBase display_base)
+{
+    char detail_str[64];
+    char packet_str[256];
+
+    out.Time(frame.mStartingSampleInclusive, trigger_sample, sample_rate);
+
+    switch ((eFrameType)frame.mType) {
+    case FRAME_PREAMBLE:
+        out.Text(",PREAMBLE,");
+        AppendNumber(out, frame.mData1, display_base);
+        out.Text(",Preamble bits");
+        break;
+    case FRAME_PSBIT:
+        out.Text(",START_BIT,0,0x00,Packet start");
+        break;
+    case FRAME_CMDBYTE:
+        out.Text(",COMMAND,");
+        AppendNumber(out, frame.mData1, display_base);
+        out.Char(',');
+        out.Text(GetCommandName((U8)frame.mData1));
+        break;
+    case FRAME_DSBIT:
+        out.Text(",START_BIT,0,0x00,Data start");
+        break;
+    case FRAME_CARDATA:
+        DecodeCarData((U8)frame.mData1, detail_str, sizeof(detail_str));
+        out.Text(",CAR_DATA,");
+        AppendNumber(out, frame.mData1, display_base);
+        out.Text(",Car");
+        out.Decimal(frame.mData2);
+        out.Text(": ");
+        out.Text(detail_str);
+        break;
+    case FRAME_CHECKSUM:
+        out.Text(",CHECKSUM,");
+        AppendNumber(out, frame.mData1, display_base);
+        if ((frame.mFlags & CHECKSUM_ERROR_FLAG) != 0) {
+            out.Text(",Checksum ERROR");
+        } else {
+            out.Text(((frame.mFlags & RECOVERED_FLAG) != 0) ? ",Checksum OK (1 bit recovered)" : ",Checksum OK");
+        }
+        break;
+    case FRAME_PEBIT:
+        out.Text(",END_BIT,0,0x00,Packet end");
+        break;
+    case FRAME_PACKET:
+        FormatPacket(frame.mData1, frame.mData2, frame.mFlags, true, true, packet_str, sizeof(packet_str));
+        out.Text(",PACKET,");
+        AppendNumber(out, PACKET_BYTE(frame.mData1, 0), display_base);
+        out.Char(',');
+        out.Text(packet_str);
+        break;
+    case FRAME_REPEAT:
+        out.Text(",REPEAT,");
+        out.Decimal(frame.mData1);
+        out.Char(',');
+        AppendNumber(out, frame.mData2, display_base, false);
+        out.Char(',');
+        out.Text(GetCommandName((U8)frame.mData2));
+        out.Text(" x");
+        out.Decimal(frame.mData1);
+        out.Text(" same as previous");
+        break;
+    case FRAME_ERR_SPAN:
+        out.Text(",ERROR_SPAN,");
+        out.Decimal(frame.mData1);
+        out.Text(",0x00,");
+        out.Decimal(frame.mData1);
+        out.Text(" consecutive errors");
+        break;
+    default:
+        out.Text(",ERROR,0,0x00,");
+        if ((frame.mFlags & BIT_ERROR_FLAG) != 0) {
+            out.Text("Bit timing error");
+        } else if ((frame.mFlags & FRAMING_ERROR_FLAG) != 0) {
+            out.Text("Framing error");
+        } else {
+            out.Text("Protocol error");
+        }
+        break;
+    }
+    out.Char('\n');
+}
+
+void SSDAnalyzerResults::GeneratePacketFile(const char *file, DisplayBase display_base, bool binary)
+{
+    // Une ligne (CSV) ou une entree de chaque colonne (binaire) par paquet,
+    // lus dans la table des paquets, un bloc a la fois
+    U64 trigger_sample = mAnalyzer->GetTriggerSample();
+    U32 sample_rate = mAnalyzer->GetSampleRate();
+    U64 num_packets = mPackets.GetCount();
+
+    void *f = AnalyzerHelpers::StartFile(file, binary);
+    SSDExportWriter out(&WriteToFile, f);
+    SSDPacketRecord packet;
+    SSDColumnWriter columns;
+
+    if (!binary)
+        out.Text("Time [s],Command,Car1,Car2,Car3,Car4,Car5,Car6,Checksum,Computed,Valid,Duration [us],Repeat\n");
 
-        AnalyzerHelpers::AppendToFile((U8 *)ss.str().c_str(), ss.str().length(), f);
-        ss.str(std::string());
+    for (U64 i = 0; i < num_packets; ) {
+        const SSDPacketTable::Block *block = mPackets.GetBlock(i);
+        U32 index = (U32)(i & (SSD_PACKET_BLOCK_ROWS - 1));
+        U32 end = (num_packets - i < SSD_PACKET_BLOCK_ROWS - index) ? index + (U32)(num_packets - i) : SSD_PACKET_BLOCK_ROWS;
 
-        if (UpdateExportProgressAndCheckForCancel(i, num_frames) == true) {
+        for (; index < end; index++, i++) {
+            SSDPacketTable::GetRecord(*block, index, &packet);
+            if (binary)
+                columns.Add(packet);
+            else
+                WritePacketRow(out, packet, trigger_sample, sample_rate, display_base);
+        }
+
+        if (UpdateExportProgressAndCheckForCancel(i, num_packets) == true) {
+            out.Flush();
             AnalyzerHelpers::EndFile(f);
             return;
         }
     }
 
-    UpdateExportProgressAndCheckForCancel(num_frames, num_frames);
+    if (binary)
+        columns.Write(out, sample_rate, trigger_sample);
+    out.Flush();
+    UpdateExportProgressAndCheckForCancel(num_packets, num_packets);
+    AnalyzerHelpers::EndFile(f);
+}
+
+void SSDAnalyzerResults::WritePacketRow(SSDExportWriter &out, const SSDPacketRecord &packet, U64 trigger_sample, U32 sample_rate,
+                                        DisplayBase display_base)
+{
+    char detail_str[64];
+    U8 count = PACKET_DATA_COUNT(packet.mInfo);
+
+    out.Time(packet.mStart, trigger_sample, sample_rate);
+    out.Char(',');
+    AppendNumber(out, PACKET_BYTE(packet.mData, 0), display_base, false);
+    for (U8 i = 1; i <= 6; i++) {
+        out.Char(',');
+        if (i <= count) {
+            DecodeCarData(PACKET_BYTE(packet.mData, i), detail_str, sizeof(detail_str));
+            out.Text(detail_str);
+        }
+    }
+    out.Char(',');
+    AppendNumber(out, PACKET_BYTE(packet.mData, PACKET_CHECKSUM_INDEX), display_base, false);
+    out.Char(',');
+    AppendNumber(out, PACKET_CALC_CHECKSUM(packet.mInfo), display_base, false);
+    out.Text(((packet.mFlags & CHECKSUM_ERROR_FLAG) == 0) ? ",1," : ",0,");
+    out.Fixed((packet.mEnd - packet.mStart) * 1000000, sample_rate, 3);
+    out.Char(',');
+    out.Decimal(packet.mRepeat);
+    out.Char('\n');
+}
+
+void SSDAnalyzerResults::WriteToFile(void *context, const char *data, U32 length)
+{
+    AnalyzerHelpers::AppendToFile((const U8 *)data, length, context);
+}
+
+void SSDAnalyzerResults::WriteToText(void *context, const char *data, U32 length)
+{
+    ((std::string *)context)->append(data, length);
+}
+
+void SSDAnalyzerResults::AppendNumber(SSDExportWriter &out, U64 value, DisplayBase display_base, bool both)
+{
+    // Colonnes Data (decimal) et Hex (base d'affichage). Decimal et hexa a la
+    // main, les autres bases (rares) par le SDK.
+    if (both) {
+        out.Decimal(value);
+        out.Char(',');
+    }
+    if (display_base == Decimal) {
+        out.Decimal(value);
+    } else if (display_base == Hexadecimal) {
+        out.Hex(value, 2);
+    } else {
+        char number_str[128];
+        AnalyzerHelpers::GetNumberString(value, display_base, 8, number_str, sizeof(number_str));
+        out.Text(number_str);
+    }
+}
+
+void SSDAnalyzerResults::GenerateStatsFile(const char *file, bool timing)
+{
+    // Compteurs au dernier commit du decodeur
+    SSDRunStats stats;
+    mAnalyzer->GetRunStats(&stats);
+    mPackets.GetTotals(&stats.mTableRows, &stats.mTablePackets, &stats.mTableChecksumErrors);
+    stats.mTableBytes = mPackets.GetMemoryBytes();
+
+    std::string json;
+    if (timing)
+        stats.mTiming.WriteJson(stats.mLimits, &json);
+    else
+        stats.WriteJson(&json);
+
+    void *f = AnalyzerHelpers::StartFile(file);
+    AnalyzerHelpers::AppendToFile((U8 *)json.c_str(), (U32)json.length(), f);
     AnalyzerHelpers::EndFile(f);
 }
 
 void SSDAnalyzerResults::GenerateFrameTabularText(U64 frame_index, DisplayBase display_base)
 {
-    char result_str[128];
+    char result_str[320];           // packet_str plus le prefixe "repeated xN"
     char detail_str[64];
+    char packet_str[256];
+    SSDPacketRecord packet;
+    U64 row;
 
     ClearTabularText();
     Frame frame = GetFrame(frame_index);
@@ -252,12 +532,30 @@ void SSDAnalyzerResults::GenerateFrameTabularText(U64 frame_index, DisplayBase d
                 frame.mData2, frame.mData1, detail_str);
         break;
     case FRAME_CHECKSUM:
-        snprintf(result_str, sizeof(result_str), "Checksum: %#02llx %s", 
-                frame.mData1, checksum_error ? "[ERROR]" : "[OK]");
+        snprintf(result_str, sizeof(result_str), "Checksum: %#02llx %s%s", 
+                frame.mData1, checksum_error ? "[ERROR]" : "[OK]",
+                ((frame.mFlags & RECOVERED_FLAG) != 0) ? " [RECOVERED]" : "");
         break;
     case FRAME_PEBIT:
         snprintf(result_str, sizeof(result_str), "Packet End Bit");
         break;
+    case FRAME_PACKET:
+        FormatPacket(frame.mData1, frame.mData2, frame.mFlags, mSettings->mShowCarDetails, true, result_str, sizeof(result_str));
+        break;
+    case FRAME_REPEAT:
+        // Les octets repetes viennent de la ligne de la table des paquets
+        if (mPackets.FindFrame(frame_index, &row) && mPackets.GetRecord(row, &packet)) {
+            FormatPacket(packet.mData, packet.mInfo, packet.mFlags, mSettings->mShowCarDetails, false, packet_str, sizeof(packet_str));
+            snprintf(result_str, sizeof(result_str), "%s repeated x%llu (unchanged)%s",
+                    GetCommandName((U8)frame.mData2), frame.mData1, packet_str);
+        } else {
+            snprintf(result_str, sizeof(result_str), "%s repeated x%llu (unchanged)",
+                    GetCommandName((U8)frame.mData2), frame.mData1);
+        }
+        break;
+    case FRAME_ERR_SPAN:
+        snprintf(result_str, sizeof(result_str), "%llu consecutive errors", frame.mData1);
+        break;
     default:
         if (bit_error) {
             snprintf(result_str, sizeof(result_str), "Bit Timing Error");
@@ -2,23 +2,15 @@
 #define SSD_ANALYZER_RESULTS
 
 #include <AnalyzerResults.h>
+#include <string>
+#include <vector>
+#include "SSDProtocol.h"
+#include "SSDExportWriter.h"
+#include "SSDColumnFile.h"
+#include "SSDPacketTable.h"
 
-#define BIT_ERROR_FLAG ( 1 << 1 )
-#define PACKET_ERROR_FLAG ( 1 << 2 )
-#define FRAMING_ERROR_FLAG (1 << 3)
-#define CHECKSUM_ERROR_FLAG (1 << 4)
-
-enum eFrameType { 
-    FRAME_PREAMBLE, 
-    FRAME_PSBIT,        // Packet Start Bit
-    FRAME_CMDBYTE,      // Command Byte (RACE or PROGRAM)
-    FRAME_DSBIT,        // Data Start Bit
-    FRAME_CARDATA,      // Car Data Byte
-    FRAME_CHECKSUM,     // Checksum Byte
-    FRAME_PEBIT,        // Packet End Bit
-    FRAME_ERR,          // Error Frame
-    FRAME_END_ERR       // End Error Frame
-};
+#define EXPORT_SHARD_FRAMES     8192    // Frames formatees d'un bloc par un thread (export CSV)
+#define EXPORT_MAX_THREADS      16
 
 class SSDAnalyzer;
 class SSDAnalyzerSettings;
@@ -36,15 +28,37 @@ public:
     virtual void GeneratePacketTabularText(U64 packet_id, DisplayBase display_base);
     virtual void GenerateTransactionTabularText(U64 transaction_id, DisplayBase display_base);
 
+    // Filled by the analyzer with the frames, read by the exports and the tabular text
+    SSDPacketTable& GetPacketTable() { return mPackets; }
+
 protected:  //vars
     SSDAnalyzerSettings *mSettings;
     SSDAnalyzer *mAnalyzer;
+    SSDPacketTable mPackets;
 private:
     char sParseBuf[128];
+
+    // Frames of the CSV export, formatted on a worker thread into mText
+    struct ExportShard
+    {
+        std::vector<Frame> mFrames;
+        std::string mText;
+        bool mDone;
+    };
     
     // Helper functions
     const char* GetCommandName(U8 command);
     void DecodeCarData(U8 carData, char* buffer, int bufferSize);
+    void FormatPacket(U64 data, U64 info, U8 flags, bool bDetails, bool bCommand, char* buffer, int bufferSize);
+    void GenerateStatsFile(const char *file, bool timing);
+    void FormatShard(ExportShard *shard, U64 trigger_sample, U32 sample_rate, DisplayBase display_base);
+    void WriteFrameRow(SSDExportWriter &out, const Frame &frame, U64 trigger_sample, U32 sample_rate, DisplayBase display_base);
+    void AppendNumber(SSDExportWriter &out, U64 value, DisplayBase display_base, bool both = true);
+    void GeneratePacketFile(const char *file, DisplayBase display_base, bool binary);
+    void WritePacketRow(SSDExportWriter &out, const SSDPacketRecord &packet, U64 trigger_sample, U32 sample_rate,
+                        DisplayBase display_base);
+    static void WriteToFile(void *context, const char *data, U32 length);
+    static void WriteToText(void *context, const char *data, U32 length);
 };
 
 #endif //SSD_ANALYZER_RESULTS
\ No newline at end of file
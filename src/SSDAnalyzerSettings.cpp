@@ -10,7 +10,19 @@ SSDAnalyzerSettings::SSDAnalyzerSettings()
       mPreambleBits(14),
       mMode(SSDAnalyzerEnums::MODE_STANDARD),
       mCalPPM(0),
-      mShowCarDetails(true)
+      mShowCarDetails(true),
+      mDecoderThreads(1),
+      mCommitMode(SSDAnalyzerEnums::COMMIT_PACKET),
+      mCommitFrames(1000),
+      mCommitMs(100),
+      mFrameMode(SSDAnalyzerEnums::FRAMES_FULL),
+      mFoldRepeats(false),
+      mCoalesceErrors(false),
+      mFrameV2(true),
+      mAutoCalibration(false),
+      mDeglitchNs(0),
+      mBitRecovery(false),
+      mTimingReport(false)
 {
     mInputChannelInterface.reset(new AnalyzerSettingInterfaceChannel());
     mInputChannelInterface->SetTitleAndTooltip(CHANNEL_NAME, "SSD Protocol Signal Input");
@@ -29,6 +41,7 @@ SSDAnalyzerSettings::SSDAnalyzerSettings()
     mModeInterface->ClearNumbers();
     mModeInterface->AddNumber(SSDAnalyzerEnums::MODE_STANDARD, "Standard", "Standard SSD timing tolerance");
     mModeInterface->AddNumber(SSDAnalyzerEnums::MODE_TOLERANT, "Tolerant", "More tolerant timing for noisy signals");
+    mModeInterface->AddNumber(SSDAnalyzerEnums::MODE_ADAPTIVE, "Adaptive", "Standard windows that follow the clock drift of the controller, within the tolerant limits");
     mModeInterface->SetNumber(mMode);
     AddInterface(mModeInterface.get());
     
@@ -39,14 +52,102 @@ SSDAnalyzerSettings::SSDAnalyzerSettings()
     mCalPPMInterface->SetInteger(mCalPPM);
     AddInterface(mCalPPMInterface.get());
 
+    mAutoCalibrationInterface.reset(new AnalyzerSettingInterfaceBool());
+    mAutoCalibrationInterface->SetTitleAndTooltip("Auto Calibration", "Measure the half-bit timing on the first edges of the capture and center the timing windows on it (on top of the calibration factor)");
+    mAutoCalibrationInterface->SetValue(mAutoCalibration);
+    AddInterface(mAutoCalibrationInterface.get());
+
+    mDeglitchNsInterface.reset(new AnalyzerSettingInterfaceInteger());
+    mDeglitchNsInterface->SetTitleAndTooltip("Deglitch Filter [ns]", "Pulses shorter than this are merged into the surrounding interval before decoding (0 = off, 0 to 20000 ns)");
+    mDeglitchNsInterface->SetMin(0);
+    mDeglitchNsInterface->SetMax(20000);
+    mDeglitchNsInterface->SetInteger(mDeglitchNs);
+    AddInterface(mDeglitchNsInterface.get());
+
+    mBitRecoveryInterface.reset(new AnalyzerSettingInterfaceBool());
+    mBitRecoveryInterface->SetTitleAndTooltip("Bit Error Recovery", "A single half-bit between the '1' and '0' windows takes the value of the other half of its bit, if the checksum (and the PROGRAM repetition) confirms it");
+    mBitRecoveryInterface->SetValue(mBitRecovery);
+    AddInterface(mBitRecoveryInterface.get());
+
+    mTimingReportInterface.reset(new AnalyzerSettingInterfaceBool());
+    mTimingReportInterface->SetTitleAndTooltip("Timing Report", "Histograms of the half-bit and gap lengths, reported against the timing windows (timing report export, 'ssd_timing' FrameV2)");
+    mTimingReportInterface->SetValue(mTimingReport);
+    AddInterface(mTimingReportInterface.get());
+
     mShowCarDetailsInterface.reset(new AnalyzerSettingInterfaceBool());
     mShowCarDetailsInterface->SetTitleAndTooltip("Show Car Details", "Display detailed car data (brake, speed, lane change)");
     mShowCarDetailsInterface->SetValue(mShowCarDetails);
     AddInterface(mShowCarDetailsInterface.get());
 
-    AddExportOption(0, "Export as text/csv file");
-    AddExportExtension(0, "Text file", "txt");
-    AddExportExtension(0, "CSV file", "csv");
+    mDecoderThreadsInterface.reset(new AnalyzerSettingInterfaceInteger());
+    mDecoderThreadsInterface->SetTitleAndTooltip("Decoder Threads", "Threads used to decode an existing capture (1 = serial decoding)");
+    mDecoderThreadsInterface->SetMin(1);
+    mDecoderThreadsInterface->SetMax(64);
+    mDecoderThreadsInterface->SetInteger(mDecoderThreads);
+    AddInterface(mDecoderThreadsInterface.get());
+
+    mCommitModeInterface.reset(new AnalyzerSettingInterfaceNumberList());
+    mCommitModeInterface->SetTitleAndTooltip("Commit Results", "How often decoded frames are handed to Logic 2 for display");
+    mCommitModeInterface->ClearNumbers();
+    mCommitModeInterface->AddNumber(SSDAnalyzerEnums::COMMIT_FRAME, "Every frame", "Commit after each frame (slowest)");
+    mCommitModeInterface->AddNumber(SSDAnalyzerEnums::COMMIT_PACKET, "Every packet", "Commit at the end of each packet");
+    mCommitModeInterface->AddNumber(SSDAnalyzerEnums::COMMIT_BATCH, "Every N frames / ms", "Commit at the first packet end once N frames or N ms are reached");
+    mCommitModeInterface->SetNumber(mCommitMode);
+    AddInterface(mCommitModeInterface.get());
+
+    mCommitFramesInterface.reset(new AnalyzerSettingInterfaceInteger());
+    mCommitFramesInterface->SetTitleAndTooltip("Commit Every N Frames", "Frames pending before a commit (Every N frames / ms)");
+    mCommitFramesInterface->SetMin(1);
+    mCommitFramesInterface->SetMax(1000000);
+    mCommitFramesInterface->SetInteger(mCommitFrames);
+    AddInterface(mCommitFramesInterface.get());
+
+    mCommitMsInterface.reset(new AnalyzerSettingInterfaceInteger());
+    mCommitMsInterface->SetTitleAndTooltip("Commit Every N ms", "Maximum time between two commits (Every N frames / ms)");
+    mCommitMsInterface->SetMin(1);
+    mCommitMsInterface->SetMax(10000);
+    mCommitMsInterface->SetInteger(mCommitMs);
+    AddInterface(mCommitMsInterface.get());
+
+    mFrameModeInterface.reset(new AnalyzerSettingInterfaceNumberList());
+    mFrameModeInterface->SetTitleAndTooltip("Frame Mode", "Frames produced for each packet");
+    mFrameModeInterface->ClearNumbers();
+    mFrameModeInterface->AddNumber(SSDAnalyzerEnums::FRAMES_FULL, "Full", "Every field, start/end bits and markers");
+    mFrameModeInterface->AddNumber(SSDAnalyzerEnums::FRAMES_COMPACT, "Compact", "Preamble, command, car data and checksum; start bits merged into the next byte");
+    mFrameModeInterface->AddNumber(SSDAnalyzerEnums::FRAMES_PACKET, "Packet", "One frame per packet with its 8 bytes");
+    mFrameModeInterface->SetNumber(mFrameMode);
+    AddInterface(mFrameModeInterface.get());
+
+    mFoldRepeatsInterface.reset(new AnalyzerSettingInterfaceBool());
+    mFoldRepeatsInterface->SetTitleAndTooltip("Fold Repeated Packets", "Packets identical to the previous one of the same command become a single \"repeat xN\" frame");
+    mFoldRepeatsInterface->SetValue(mFoldRepeats);
+    AddInterface(mFoldRepeatsInterface.get());
+
+    mCoalesceErrorsInterface.reset(new AnalyzerSettingInterfaceBool());
+    mCoalesceErrorsInterface->SetTitleAndTooltip("Coalesce Errors", "Consecutive errors up to the next preamble or packet gap become a single \"ERR xN\" frame");
+    mCoalesceErrorsInterface->SetValue(mCoalesceErrors);
+    AddInterface(mCoalesceErrorsInterface.get());
+
+    mFrameV2Interface.reset(new AnalyzerSettingInterfaceBool());
+    mFrameV2Interface->SetTitleAndTooltip("FrameV2 Output", "Also produce FrameV2 frames (data table, high level analyzers). Off: bubbles and export only, faster");
+    mFrameV2Interface->SetValue(mFrameV2);
+    AddInterface(mFrameV2Interface.get());
+
+    AddExportOption(SSDAnalyzerEnums::EXPORT_TEXT, "Export as text/csv file");
+    AddExportExtension(SSDAnalyzerEnums::EXPORT_TEXT, "Text file", "txt");
+    AddExportExtension(SSDAnalyzerEnums::EXPORT_TEXT, "CSV file", "csv");
+
+    AddExportOption(SSDAnalyzerEnums::EXPORT_PACKETS, "Export packets as CSV (one row per packet)");
+    AddExportExtension(SSDAnalyzerEnums::EXPORT_PACKETS, "CSV file", "csv");
+
+    AddExportOption(SSDAnalyzerEnums::EXPORT_COLUMNS, "Export packets as binary columns");
+    AddExportExtension(SSDAnalyzerEnums::EXPORT_COLUMNS, "SSD column file", "ssdcol");
+
+    AddExportOption(SSDAnalyzerEnums::EXPORT_STATS, "Export decoder statistics (JSON)");
+    AddExportExtension(SSDAnalyzerEnums::EXPORT_STATS, "JSON file", "json");
+
+    AddExportOption(SSDAnalyzerEnums::EXPORT_TIMING, "Export timing report (JSON)");
+    AddExportExtension(SSDAnalyzerEnums::EXPORT_TIMING, "JSON file", "json");
 
     ClearChannels();
     AddChannel(mInputChannel, CHANNEL_NAME, false);
@@ -63,6 +164,18 @@ bool SSDAnalyzerSettings::SetSettingsFromInterfaces()
     mMode = (SSDAnalyzerEnums::eAnalyzerMode)(int)mModeInterface->GetNumber();
     mCalPPM = mCalPPMInterface->GetInteger();
     mShowCarDetails = mShowCarDetailsInterface->GetValue();
+    mDecoderThreads = mDecoderThreadsInterface->GetInteger();
+    mCommitMode = (SSDAnalyzerEnums::eCommitMode)(int)mCommitModeInterface->GetNumber();
+    mCommitFrames = mCommitFramesInterface->GetInteger();
+    mCommitMs = mCommitMsInterface->GetInteger();
+    mFrameMode = (SSDAnalyzerEnums::eFrameMode)(int)mFrameModeInterface->GetNumber();
+    mFoldRepeats = mFoldRepeatsInterface->GetValue();
+    mCoalesceErrors = mCoalesceErrorsInterface->GetValue();
+    mFrameV2 = mFrameV2Interface->GetValue();
+    mAutoCalibration = mAutoCalibrationInterface->GetValue();
+    mDeglitchNs = mDeglitchNsInterface->GetInteger();
+    mBitRecovery = mBitRecoveryInterface->GetValue();
+    mTimingReport = mTimingReportInterface->GetValue();
     
     ClearChannels();
     AddChannel(mInputChannel, CHANNEL_NAME, true);
@@ -77,6 +190,18 @@ void SSDAnalyzerSettings::UpdateInterfacesFromSettings()
     mModeInterface->SetNumber(mMode);
     mCalPPMInterface->SetInteger(mCalPPM);
     mShowCarDetailsInterface->SetValue(mShowCarDetails);
+    mDecoderThreadsInterface->SetInteger(mDecoderThreads);
+    mCommitModeInterface->SetNumber(mCommitMode);
+    mCommitFramesInterface->SetInteger(mCommitFrames);
+    mCommitMsInterface->SetInteger(mCommitMs);
+    mFrameModeInterface->SetNumber(mFrameMode);
+    mFoldRepeatsInterface->SetValue(mFoldRepeats);
+    mCoalesceErrorsInterface->SetValue(mCoalesceErrors);
+    mFrameV2Interface->SetValue(mFrameV2);
+    mAutoCalibrationInterface->SetValue(mAutoCalibration);
+    mDeglitchNsInterface->SetInteger(mDeglitchNs);
+    mBitRecoveryInterface->SetValue(mBitRecovery);
+    mTimingReportInterface->SetValue(mTimingReport);
 }
 
 void SSDAnalyzerSettings::LoadSettings(const char *settings)
@@ -95,6 +220,24 @@ void SSDAnalyzerSettings::LoadSettings(const char *settings)
     text_archive >> *(int *)&mMode;
     text_archive >> mCalPPM;
     text_archive >> mShowCarDetails;
+    text_archive >> mDecoderThreads;
+    int nCommitMode = mCommitMode;
+    text_archive >> nCommitMode;
+    if (nCommitMode >= SSDAnalyzerEnums::COMMIT_FRAME && nCommitMode <= SSDAnalyzerEnums::COMMIT_BATCH)
+        mCommitMode = (SSDAnalyzerEnums::eCommitMode)nCommitMode;
+    text_archive >> mCommitFrames;
+    text_archive >> mCommitMs;
+    int nFrameMode = mFrameMode;
+    text_archive >> nFrameMode;
+    if (nFrameMode >= SSDAnalyzerEnums::FRAMES_FULL && nFrameMode <= SSDAnalyzerEnums::FRAMES_PACKET)
+        mFrameMode = (SSDAnalyzerEnums::eFrameMode)nFrameMode;
+    text_archive >> mFoldRepeats;
+    text_archive >> mCoalesceErrors;
+    text_archive >> mFrameV2;
+    text_archive >> mAutoCalibration;
+    text_archive >> mDeglitchNs;
+    text_archive >> mBitRecovery;
+    text_archive >> mTimingReport;
 
     ClearChannels();
     AddChannel(mInputChannel, CHANNEL_NAME, true);
@@ -112,6 +255,18 @@ const char *SSDAnalyzerSettings::SaveSettings()
     text_archive << (int)mMode;
     text_archive << mCalPPM;
     text_archive << mShowCarDetails;
+    text_archive << mDecoderThreads;
+    text_archive << (int)mCommitMode;
+    text_archive << mCommitFrames;
+    text_archive << mCommitMs;
+    text_archive << (int)mFrameMode;
+    text_archive << mFoldRepeats;
+    text_archive << mCoalesceErrors;
+    text_archive << mFrameV2;
+    text_archive << mAutoCalibration;
+    text_archive << mDeglitchNs;
+    text_archive << mBitRecovery;
+    text_archive << mTimingReport;
 
     return SetReturnString(text_archive.GetString());
 }
\ No newline at end of file
@@ -6,9 +6,12 @@
 
 namespace SSDAnalyzerEnums
 {
-    enum eAnalyzerMode { MODE_STANDARD, MODE_TOLERANT };
+    enum eAnalyzerMode { MODE_STANDARD, MODE_TOLERANT, MODE_ADAPTIVE };
     enum eSignalPolarity { POLARITY_NORMAL, POLARITY_INVERTED };
     enum FrameType { TYPE_Preamble, TYPE_Command, TYPE_CarData, TYPE_Checksum };
+    enum eCommitMode { COMMIT_FRAME, COMMIT_PACKET, COMMIT_BATCH };
+    enum eFrameMode { FRAMES_FULL, FRAMES_COMPACT, FRAMES_PACKET };
+    enum eExportType { EXPORT_TEXT, EXPORT_STATS, EXPORT_TIMING, EXPORT_PACKETS, EXPORT_COLUMNS };
 };
 
 class SSDAnalyzerSettings : public AnalyzerSettings
@@ -28,6 +31,18 @@ public:
     SSDAnalyzerEnums::eSignalPolarity mPolarity;
     int     mCalPPM;
     bool    mShowCarDetails;
+    int     mDecoderThreads;
+    SSDAnalyzerEnums::eCommitMode mCommitMode;
+    int     mCommitFrames;
+    int     mCommitMs;
+    SSDAnalyzerEnums::eFrameMode mFrameMode;
+    bool    mFoldRepeats;
+    bool    mCoalesceErrors;
+    bool    mFrameV2;
+    bool    mAutoCalibration;
+    int     mDeglitchNs;
+    bool    mBitRecovery;
+    bool    mTimingReport;
 
 protected:
     std::unique_ptr< AnalyzerSettingInterfaceChannel >    mInputChannelInterface;
@@ -36,6 +51,18 @@ protected:
     std::unique_ptr< AnalyzerSettingInterfaceNumberList > mPolarityInterface;
     std::unique_ptr< AnalyzerSettingInterfaceInteger >    mCalPPMInterface;
     std::unique_ptr< AnalyzerSettingInterfaceBool >       mShowCarDetailsInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceInteger >    mDecoderThreadsInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceNumberList > mCommitModeInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceInteger >    mCommitFramesInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceInteger >    mCommitMsInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceNumberList > mFrameModeInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceBool >       mFoldRepeatsInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceBool >       mCoalesceErrorsInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceBool >       mFrameV2Interface;
+    std::unique_ptr< AnalyzerSettingInterfaceBool >       mAutoCalibrationInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceInteger >    mDeglitchNsInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceBool >       mBitRecoveryInterface;
+    std::unique_ptr< AnalyzerSettingInterfaceBool >       mTimingReportInterface;
 };
 
 #endif //SSD_ANALYZER_SETTINGS
\ No newline at end of file
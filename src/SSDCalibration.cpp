@@ -0,0 +1,76 @@
+#include "SSDCalibration.h"
+#include <math.h>
+#include <string.h>
+
+// Centres des fenetres nominales (voir SSDDecoderBase::GetTimingLimits)
+#define NOMINAL_1HBIT_US    60.0    // 57us a 63us
+#define PEAK_HALF_WIDTH_US  3.0     // Moyenne ponderee autour du pic
+
+SSDCalibration::SSDCalibration(U32 nSampleRateHz)
+    : mBinsPerSample(BINS_PER_US * 1000000.0 / nSampleRateHz),
+    mIntervals(0),
+    mSkew(1.0),
+    m1HBitCenter(0.0),
+    m0HBitCenter(0.0)
+{
+    memset(mHistogram, 0, sizeof(mHistogram));
+}
+
+void SSDCalibration::AddInterval(U64 nInterval)
+{
+    mIntervals++;
+
+    // Les gaps et les pauses depassent l'histogramme, ils ne comptent pas
+    double dBin = (double)nInterval * mBinsPerSample;
+    if (dBin < BIN_COUNT)
+        mHistogram[(U32)dBin]++;
+}
+
+double SSDCalibration::GetPeakCenter(double dFromUs, double dToUs, U32* nCount) const
+{
+    U32 nFrom = (U32)(dFromUs * BINS_PER_US);
+    U32 nTo = (U32)(dToUs * BINS_PER_US);
+
+    U32 nPeak = nFrom;
+    for (U32 i = nFrom; i < nTo; i++) {
+        if (mHistogram[i] > mHistogram[nPeak])
+            nPeak = i;
+    }
+
+    *nCount = 0;
+    if (mHistogram[nPeak] == 0)
+        return 0.0;
+
+    // Le pic seul est quantifie a 0.25us: centre de gravite des bins voisins
+    U32 nHalfWidth = (U32)(PEAK_HALF_WIDTH_US * BINS_PER_US);
+    U32 nFirst = (nPeak > nHalfWidth) ? nPeak - nHalfWidth : 0;
+    U32 nLast = (nPeak + nHalfWidth < BIN_COUNT) ? nPeak + nHalfWidth : BIN_COUNT - 1;
+
+    double dSum = 0.0;
+    for (U32 i = nFirst; i <= nLast; i++) {
+        dSum += (i + 0.5) * mHistogram[i];
+        *nCount += mHistogram[i];
+    }
+    return dSum / *nCount / BINS_PER_US;
+}
+
+bool SSDCalibration::Compute()
+{
+    U32 nOnes;
+    U32 nZeros;
+
+    // Fenetres de recherche larges: +/-17% autour des valeurs nominales
+    m1HBitCenter = GetPeakCenter(50.0, 70.0, &nOnes);
+    m0HBitCenter = GetPeakCenter(95.0, 135.0, &nZeros);
+    mSkew = 1.0;
+
+    if (nOnes < SSD_CALIBRATION_MIN_HBITS)
+        return false;
+
+    double dSkew = m1HBitCenter / NOMINAL_1HBIT_US;
+    if (fabs(dSkew - 1.0) > SSD_CALIBRATION_MAX_SKEW)
+        return false;
+
+    mSkew = dSkew;
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef SSD_CALIBRATION_H
+#define SSD_CALIBRATION_H
+
+#include "SSDEdgeSource.h"
+
+#define SSD_CALIBRATION_EDGES       4096    // Intervals read by the pre-pass
+#define SSD_CALIBRATION_MIN_HBITS   64      // '1' half-bits needed for a result (2 or 3 preambles)
+#define SSD_CALIBRATION_MAX_SKEW    0.1     // Same range as the PPM setting (+/-100000)
+
+// Automatic bit timing calibration ("Auto Calibration", ssd-decode -a).
+// A pre-pass puts the first edges of the capture in a histogram of interval
+// lengths. The centre of the '1' half-bit peak, against the centre of its
+// nominal window (60us), gives the clock skew of the controller, and
+// GetTimingLimits() scales all the windows by it. The preambles make the '1'
+// peak the highest and the narrowest one, the '0' peak is only reported.
+class SSDCalibration
+{
+public:
+    SSDCalibration(U32 nSampleRateHz);
+
+    void AddInterval(U64 nInterval);
+
+    // Feeds up to nMax intervals from a copy of the source: the caller's
+    // source does not move, so the decoder starts from the same edge
+    template <class Source>
+    U32 AddSource(Source source, U32 nMax)
+    {
+        U32 intervals[256];
+        U64 nLong = 0;
+        U32 nDone = 0;
+
+        try {
+            while (nDone < nMax) {
+                U32 nCount = source.Fetch(intervals, (nMax - nDone < 256) ? nMax - nDone : 256, &nLong);
+                for (U32 i = 0; i < nCount; i++)
+                    AddInterval((intervals[i] == INTERVAL_LONG) ? nLong : intervals[i]);
+                nDone += nCount;
+            }
+        }
+        catch (SSDEndOfData&) {
+            // Capture plus courte que la pre-passe
+        }
+        return nDone;
+    }
+
+    bool Compute();                 // false: not enough '1' half-bits or skew out of range, GetSkew() stays 1.0
+
+    double GetSkew() const { return mSkew; }                // Measured / nominal half-bit length
+    double Get1HBitCenter() const { return m1HBitCenter; }  // us, 0.0 if no peak
+    double Get0HBitCenter() const { return m0HBitCenter; }  // us, 0.0 if no peak
+    U32 GetIntervalCount() const { return mIntervals; }
+
+protected:
+    enum { BINS_PER_US = 4, BIN_COUNT = 200 * BINS_PER_US };     // 0.25us bins up to 200us
+
+    double GetPeakCenter(double dFromUs, double dToUs, U32* nCount) const;
+
+protected: //vars
+    double mBinsPerSample;
+    U32 mHistogram[BIN_COUNT];
+    U32 mIntervals;
+    double mSkew;
+    double m1HBitCenter;
+    double m0HBitCenter;
+};
+
+#endif //SSD_CALIBRATION_H
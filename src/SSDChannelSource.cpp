@@ -0,0 +1,45 @@
+#include "SSDChannelSource.h"
+#include <AnalyzerChannelData.h>
+
+U32 SSDChannelSource::Fetch(U32* intervals, U32 nMax, U64* nLong)
+{
+    if (!mOnChannel) {
+        if (!mMemory.IsEmpty())
+            return mMemory.Fetch(intervals, nMax, nLong);
+        if (mChannel == NULL)
+            throw SSDEndOfData();
+        mOnChannel = true;      // Suite sur le canal
+    }
+
+    // Wait for one interval, then take every edge the host already has
+    // without blocking, up to nMax
+    U64 nLast = mChannel->GetSampleNumber();
+    U32 nCount = 0;
+
+    do {
+        mChannel->AdvanceToNextEdge();
+        U64 nEdge = mChannel->GetSampleNumber();
+        U64 nInterval;
+        bool bReady = mDeglitch.Push(nEdge - nLast, &nInterval);
+        nLast = nEdge;
+        if (!bReady)
+            continue;
+
+        if (nInterval >= INTERVAL_LONG) {
+            *nLong = nInterval;
+            intervals[nCount++] = INTERVAL_LONG;
+            break;
+        }
+
+        intervals[nCount++] = (U32)nInterval;
+    } while (nCount == 0 || (nCount < nMax && mChannel->DoMoreTransitionsExistInCurrentData()));
+
+    return nCount;
+}
+
+bool SSDChannelSource::IsWaitingForData() const
+{
+    if (mChannel == NULL || !mMemory.IsEmpty())
+        return false;
+    return !mChannel->DoMoreTransitionsExistInCurrentData();
+}
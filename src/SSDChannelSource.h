@@ -0,0 +1,52 @@
+#ifndef SSD_CHANNEL_SOURCE_H
+#define SSD_CHANNEL_SOURCE_H
+
+#include "SSDDecoder.h"
+
+class AnalyzerChannelData;
+
+// Edge source reading the Logic 2 channel (see SSDEdgeSource.h).
+// It can start with intervals already read from the channel (parallel
+// decoding) and goes on with the channel once they are used up.
+class SSDChannelSource
+{
+public:
+    SSDChannelSource()
+        : mChannel(NULL),
+        mOnChannel(true)
+    {
+    }
+
+    explicit SSDChannelSource(AnalyzerChannelData* channel)
+        : mChannel(channel),
+        mOnChannel(true)
+    {
+    }
+
+    // channel == NULL: SSDEndOfData at the end of the intervals
+    SSDChannelSource(const SSDMemorySource& memory, AnalyzerChannelData* channel)
+        : mChannel(channel),
+        mMemory(memory),
+        mOnChannel(false)
+    {
+    }
+
+    void SetChannel(AnalyzerChannelData* channel) { mChannel = channel; }
+    bool IsOnChannel() const { return mOnChannel; }
+    // Applied to the edges read from the channel (the intervals in memory are already filtered)
+    void SetDeglitch(const SSDDeglitch& deglitch) { mDeglitch = deglitch; }
+    const SSDDeglitch& GetDeglitch() const { return mDeglitch; }
+
+    U32 Fetch(U32* intervals, U32 nMax, U64* nLong);
+    bool IsWaitingForData() const;
+
+protected:
+    AnalyzerChannelData* mChannel;
+    SSDMemorySource mMemory;        // Intervals read before, then the channel
+    bool mOnChannel;
+    SSDDeglitch mDeglitch;
+};
+
+typedef SSDDecoder<SSDChannelSource> SSDChannelDecoder;
+
+#endif //SSD_CHANNEL_SOURCE_H
@@ -0,0 +1,112 @@
+#include "SSDColumnFile.h"
+#include "SSDExportWriter.h"
+#include <string.h>
+
+#define COLUMN_COUNT    10
+
+SSDColumnWriter::SSDColumnWriter()
+    : mFirstStart(0),
+    mLastStart(0)
+{
+}
+
+void SSDColumnWriter::Add(const SSDPacketRecord& packet)
+{
+    if (mCommand.empty()) {
+        mFirstStart = packet.mStart;
+        mLastStart = packet.mStart;
+    }
+
+    // Comme INTERVAL_LONG dans le ring: la valeur suit dans une colonne a part
+    U64 nDelta = packet.mStart - mLastStart;
+    mLastStart = packet.mStart;
+    if (nDelta >= SSD_COLUMN_LONG) {
+        mStartDelta.push_back(SSD_COLUMN_LONG);
+        mStartLong.push_back(nDelta);
+    }
+    else {
+        mStartDelta.push_back((U32)nDelta);
+    }
+
+    U64 nDuration = packet.mEnd - packet.mStart;
+    mDuration.push_back((nDuration < 0xFFFFFFFF) ? (U32)nDuration : 0xFFFFFFFF);
+
+    U8 nCount = PACKET_DATA_COUNT(packet.mInfo);
+    mCommand.push_back(PACKET_BYTE(packet.mData, 0));
+    for (U8 i = 1; i <= 6; i++)
+        mCar.push_back((i <= nCount) ? PACKET_BYTE(packet.mData, i) : 0);
+    mDataCount.push_back(nCount);
+    mChecksum.push_back(PACKET_BYTE(packet.mData, PACKET_CHECKSUM_INDEX));
+    mComputed.push_back(PACKET_CALC_CHECKSUM(packet.mInfo));
+    mFlags.push_back(packet.mFlags & (CHECKSUM_ERROR_FLAG | RECOVERED_FLAG));
+    mRepeat.push_back((packet.mRepeat < 0xFFFFFFFF) ? (U32)packet.mRepeat : 0xFFFFFFFF);
+}
+
+void SSDColumnWriter::Write(SSDExportWriter& out, U32 nSampleRateHz, U64 nTriggerSample) const
+{
+    struct Column
+    {
+        const char* mName;
+        const void* mData;
+        U32 mElementSize;
+        U32 mWidth;
+        U64 mSize;
+    };
+    const Column columns[COLUMN_COUNT] = {
+        { "start_delta", mStartDelta.data(), 4, 1, mStartDelta.size() * 4 },
+        { "start_long", mStartLong.data(), 8, 1, mStartLong.size() * 8 },
+        { "duration", mDuration.data(), 4, 1, mDuration.size() * 4 },
+        { "command", mCommand.data(), 1, 1, mCommand.size() },
+        { "car", mCar.data(), 1, 6, mCar.size() },
+        { "data_count", mDataCount.data(), 1, 1, mDataCount.size() },
+        { "checksum", mChecksum.data(), 1, 1, mChecksum.size() },
+        { "computed", mComputed.data(), 1, 1, mComputed.size() },
+        { "flags", mFlags.data(), 1, 1, mFlags.size() },
+        { "repeat", mRepeat.data(), 4, 1, mRepeat.size() * 4 },
+    };
+    U32 nColumns = COLUMN_COUNT;
+
+    SSDColumnFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.mMagic, SSD_COLUMN_MAGIC, sizeof(SSD_COLUMN_MAGIC));
+    header.mVersion = SSD_COLUMN_VERSION;
+    header.mHeaderSize = (U32)(sizeof(header) + nColumns * sizeof(SSDColumnInfo));
+    header.mSampleRateHz = nSampleRateHz;
+    header.mColumnCount = nColumns;
+    header.mTriggerSample = nTriggerSample;
+    header.mFirstStart = mFirstStart;
+    header.mRowCount = GetRowCount();
+    out.Bytes(&header, sizeof(header));
+
+    U64 nOffset = header.mHeaderSize;
+    for (U32 i = 0; i < nColumns; i++) {
+        nOffset = (nOffset + SSD_COLUMN_ALIGN - 1) / SSD_COLUMN_ALIGN * SSD_COLUMN_ALIGN;
+        SSDColumnInfo info;
+        memset(&info, 0, sizeof(info));
+        strncpy(info.mName, columns[i].mName, sizeof(info.mName) - 1);
+        info.mElementSize = columns[i].mElementSize;
+        info.mWidth = columns[i].mWidth;
+        info.mOffset = nOffset;
+        info.mSize = columns[i].mSize;
+        out.Bytes(&info, sizeof(info));
+        nOffset += info.mSize;
+    }
+
+    static const U8 sPadding[SSD_COLUMN_ALIGN] = { 0 };
+    U64 nWritten = header.mHeaderSize;
+    for (U32 i = 0; i < nColumns; i++) {
+        U64 nPadding = (SSD_COLUMN_ALIGN - nWritten % SSD_COLUMN_ALIGN) % SSD_COLUMN_ALIGN;
+        out.Bytes(sPadding, (U32)nPadding);
+        nWritten += nPadding;
+
+        // Colonnes de plus de 4 Go: par morceaux
+        const U8* data = (const U8*)columns[i].mData;
+        for (U64 nLeft = columns[i].mSize; nLeft != 0;) {
+            U32 nChunk = (nLeft < SSDExportWriter::BUFFER_SIZE) ? (U32)nLeft : (U32)SSDExportWriter::BUFFER_SIZE;
+            out.Bytes(data, nChunk);
+            data += nChunk;
+            nLeft -= nChunk;
+        }
+        nWritten += columns[i].mSize;
+    }
+}
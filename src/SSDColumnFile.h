@@ -0,0 +1,82 @@
+#ifndef SSD_COLUMN_FILE_H
+#define SSD_COLUMN_FILE_H
+
+#include <vector>
+#include "SSDPacketTable.h"
+
+class SSDExportWriter;
+
+// Binary columnar packet file ("Export packets as binary columns",
+// ssd-decode -f col). Little-endian. Every column starts on a
+// SSD_COLUMN_ALIGN boundary, so a consumer can map the file and use each
+// column as a plain array:
+//
+//   SSDColumnFileHeader            magic, sample rate, trigger sample, rows
+//   SSDColumnInfo[mColumnCount]    name, element size, elements per row, offset, size
+//   columns, in directory order
+//
+// Columns (one row per packet, elements per row in brackets):
+//   start_delta  U32   start sample minus the one of the previous packet
+//                      (first row: minus mFirstStart). SSD_COLUMN_LONG: the
+//                      delta is the next entry of start_long
+//   start_long   U64   deltas that do not fit in 32 bits, in order (not one per row)
+//   duration     U32   preamble start to checksum end, in samples (saturates)
+//   command      U8
+//   car          U8[6] data bytes, 0 past data_count
+//   data_count   U8
+//   checksum     U8    received
+//   computed     U8    calculated from the bytes
+//   flags        U8    CHECKSUM_ERROR_FLAG, RECOVERED_FLAG (SSDProtocol.h)
+//   repeat       U32   1, or N for a folded "repeat xN" run
+#define SSD_COLUMN_MAGIC        "SSDCOL1"
+#define SSD_COLUMN_VERSION      1
+#define SSD_COLUMN_ALIGN        64
+#define SSD_COLUMN_LONG         0xFFFFFFFF
+
+struct SSDColumnFileHeader          // 48 bytes
+{
+    char mMagic[8];
+    U32 mVersion;
+    U32 mHeaderSize;                // Header and directory, offset of the first column
+    U32 mSampleRateHz;
+    U32 mColumnCount;
+    U64 mTriggerSample;
+    U64 mFirstStart;                // Start sample of the first packet
+    U64 mRowCount;
+};
+
+struct SSDColumnInfo                // 40 bytes
+{
+    char mName[16];                 // NUL-padded
+    U32 mElementSize;               // Bytes: 1, 4 or 8
+    U32 mWidth;                     // Elements per row (start_long: 1, rows apart)
+    U64 mOffset;                    // From the start of the file
+    U64 mSize;                      // Bytes
+};
+
+// Collects the packets column by column, then writes the whole file
+class SSDColumnWriter
+{
+public:
+    SSDColumnWriter();
+
+    void Add(const SSDPacketRecord& packet);
+    U64 GetRowCount() const { return mCommand.size(); }
+    void Write(SSDExportWriter& out, U32 nSampleRateHz, U64 nTriggerSample) const;
+
+protected:
+    U64 mFirstStart;
+    U64 mLastStart;
+    std::vector<U32> mStartDelta;
+    std::vector<U64> mStartLong;
+    std::vector<U32> mDuration;
+    std::vector<U8> mCommand;
+    std::vector<U8> mCar;
+    std::vector<U8> mDataCount;
+    std::vector<U8> mChecksum;
+    std::vector<U8> mComputed;
+    std::vector<U8> mFlags;
+    std::vector<U32> mRepeat;
+};
+
+#endif //SSD_COLUMN_FILE_H
@@ -0,0 +1,392 @@
+#include "SSDDecoder.h"
+#include <math.h>
+#include <string.h>
+
+const SSDField SSDDecoderBase::sFields[] = {
+    { FIELD_NONE,      FRAME_ERR,      FSTATE_INIT },           // FSTATE_INIT
+    { FIELD_NONE,      FRAME_ERR,      FSTATE_INIT },           // FSTATE_PREAMBLE
+    { FIELD_START_BIT, FRAME_PSBIT,    FSTATE_CMDBYTE },        // FSTATE_PSBIT
+    { FIELD_BYTE,      FRAME_CMDBYTE,  FSTATE_DSBIT },          // FSTATE_CMDBYTE
+    { FIELD_START_BIT, FRAME_DSBIT,    FSTATE_DATABYTE },       // FSTATE_DSBIT
+    { FIELD_START_BIT, FRAME_DSBIT,    FSTATE_CHECKSUM },       // FSTATE_DSBIT_CHECKSUM
+    { FIELD_BYTE,      FRAME_CARDATA,  FSTATE_DSBIT },          // FSTATE_DATABYTE
+    { FIELD_BYTE,      FRAME_CHECKSUM, FSTATE_PEBIT },          // FSTATE_CHECKSUM
+    { FIELD_NONE,      FRAME_ERR,      FSTATE_INIT }            // FSTATE_PEBIT
+};
+
+// RACE et PROGRAM ont tous les deux 6 octets de donnees
+const SSDPacketLayout SSDDecoderBase::sLayouts[] = {
+    { SSD_MODE_RACE,    6 },
+    { SSD_MODE_PROGRAM, 6 }
+};
+
+SSDDecoderBase::SSDDecoderBase()
+    : mOutput(NULL),
+    mFeatures(SSD_FEATURES_ALL),
+    mPreambleBits(14),
+    mHBitShift(0),
+    mHBitTableLast(0),
+    mResync(false),
+    mTracking(false),
+    mLostSync(false),
+    mRecovery(false)
+{
+    memset(&mLimits, 0, sizeof(mLimits));
+    mStats.Clear();
+    memset(&mTrackBounds, 0, sizeof(mTrackBounds));
+    SetTracking(false, mTrackBounds);
+    Reset(0);
+}
+
+SSDDecoderBase::~SSDDecoderBase()
+{
+}
+
+void SSDDecoderBase::SetLimits(const SSDHBitLimits& limits)
+{
+    // Table only depends on the limits
+    if (mHBitTable.empty() || memcmp(&limits, &mLimits, sizeof(mLimits)) != 0) {
+        mLimits = limits;
+        BuildHBitTable();
+    }
+}
+
+SSDHBitLimits SSDDecoderBase::GetTimingLimits(U32 nSampleRateHz, bool bTolerant, int nCalPPM, double dSkew)
+{
+    // dSkew (auto calibration) moves the windows onto the measured clock of the controller
+    double dSamplesPerMicrosecond = (nSampleRateHz / 1000000.0) * dSkew;
+
+    // Use the calibration setting (PPM) to adjust the resolution of the measurements
+    double dMaxCorrection = 1.0 + (double)nCalPPM / 1000000.0;
+    double dMinCorrection = 1.0 - (double)nCalPPM / 1000000.0;
+
+    // SSD Protocol timing - TOLERANCES ELARGIES
+    // Bit 1: 57μs a 63μs par demi-bit (periode complete: 114μs a 126μs)
+    // Bit 0: 106μs a 125μs par demi-bit (periode complete: 212μs a 250μs)
+
+    SSDHBitLimits limits;
+    limits.mMaxBitLen = (UINT)round(500.0 * dSamplesPerMicrosecond * dMaxCorrection);  // Maximum bit length
+    limits.mMinPEHold = (UINT)round(26.0 * dSamplesPerMicrosecond * dMinCorrection);
+    limits.mMaxPGap = (UINT)round(30000.0 * dSamplesPerMicrosecond * dMaxCorrection);
+
+    if (bTolerant) {
+        // Mode tolerant : plages encore plus larges
+        limits.mMin1hbit = (UINT)round(55.0 * dSamplesPerMicrosecond * dMinCorrection);  // 57μs - 2μs marge
+        limits.mMax1hbit = (UINT)round(65.0 * dSamplesPerMicrosecond * dMaxCorrection);  // 63μs + 2μs marge
+        limits.mMin0hbit = (UINT)round(104.0 * dSamplesPerMicrosecond * dMinCorrection); // 106μs - 2μs marge
+        limits.mMax0hbit = (UINT)round(127.0 * dSamplesPerMicrosecond * dMaxCorrection); // 125μs + 2μs marge
+    }
+    else {
+        // Mode standard : tolerances demandees
+        limits.mMin1hbit = (UINT)round(57.0 * dSamplesPerMicrosecond * dMinCorrection);  // 57μs minimum
+        limits.mMax1hbit = (UINT)round(63.0 * dSamplesPerMicrosecond * dMaxCorrection);  // 63μs maximum
+        limits.mMin0hbit = (UINT)round(106.0 * dSamplesPerMicrosecond * dMinCorrection); // 106μs minimum
+        limits.mMax0hbit = (UINT)round(125.0 * dSamplesPerMicrosecond * dMaxCorrection); // 125μs maximum
+    }
+
+    return limits;
+}
+
+void SSDDecoderBase::SetTracking(bool bTracking, const SSDHBitLimits& bounds)
+{
+    // Depart: les fenetres en cours (SetTiming)
+    mTracking = bTracking;
+    mTrackBounds = bounds;
+    mTrackCenter1 = (mLimits.mMin1hbit + mLimits.mMax1hbit) / 2;
+    mTrackCenter0 = (mLimits.mMin0hbit + mLimits.mMax0hbit) / 2;
+    mTrackHalf1 = (mLimits.mMax1hbit - mLimits.mMin1hbit) / 2;
+    mTrackHalf0 = (mLimits.mMax0hbit - mLimits.mMin0hbit) / 2;
+    mTrackEst1 = (U64)mTrackCenter1 << 8;
+    mTrackEst0 = (U64)mTrackCenter0 << 8;
+    mTrackZeroLen = 0;
+    mTrackZeroBits = 0;
+    mTrackByteLen = 0;
+    mTrackByteOnes = 0;
+}
+
+static U32 TrackWindow(U64 nEst, U32 nCenter, U32 nHalf, U32 nMin, U32 nMax)
+{
+    // Recentrage seulement au-dela de 1/8 de la demi-largeur: la table n'est
+    // pas reconstruite a chaque paquet
+    U32 nNew = (U32)((nEst + 128) >> 8);
+    U32 nDelta = (nNew > nCenter) ? nNew - nCenter : nCenter - nNew;
+    if (nDelta <= nHalf / 8)
+        return nCenter;
+
+    // La fenetre garde sa largeur et reste dans les limites du mode tolerant
+    if (nNew + nHalf > nMax)
+        nNew = nMax - nHalf;
+    if (nNew < nMin + nHalf)
+        nNew = nMin + nHalf;
+    return nNew;
+}
+
+bool SSDDecoderBase::TrackPacket(SSDHBitLimits* limits)
+{
+    // Les bits start sont des '0' seuls; les '1' sont ce qui reste des octets
+    // une fois leurs '0' retires. Trop peu de '1': seul le '0' est suivi.
+    U32 nByteBits = (U32)(mDataBytes + 2) * 8;
+    if (mTrackZeroBits == 0 || mTrackByteOnes > nByteBits)
+        return false;
+
+    U64 nHBit0 = (mTrackZeroLen << 8) / (2 * mTrackZeroBits);
+    mTrackEst0 = mTrackEst0 - (mTrackEst0 >> SSD_TRACK_SHIFT) + (nHBit0 >> SSD_TRACK_SHIFT);
+
+    U64 nZerosLen = nHBit0 * 2 * (nByteBits - mTrackByteOnes);
+    if (mTrackByteOnes >= 8 && (mTrackByteLen << 8) > nZerosLen) {
+        U64 nHBit1 = ((mTrackByteLen << 8) - nZerosLen) / (2 * mTrackByteOnes);
+        mTrackEst1 = mTrackEst1 - (mTrackEst1 >> SSD_TRACK_SHIFT) + (nHBit1 >> SSD_TRACK_SHIFT);
+    }
+
+    U32 nCenter1 = TrackWindow(mTrackEst1, mTrackCenter1, mTrackHalf1, mTrackBounds.mMin1hbit, mTrackBounds.mMax1hbit);
+    U32 nCenter0 = TrackWindow(mTrackEst0, mTrackCenter0, mTrackHalf0, mTrackBounds.mMin0hbit, mTrackBounds.mMax0hbit);
+    if (nCenter1 == mTrackCenter1 && nCenter0 == mTrackCenter0)
+        return false;
+
+    mTrackCenter1 = nCenter1;
+    mTrackCenter0 = nCenter0;
+    *limits = mLimits;
+    limits->mMin1hbit = nCenter1 - mTrackHalf1;
+    limits->mMax1hbit = nCenter1 + mTrackHalf1;
+    limits->mMin0hbit = nCenter0 - mTrackHalf0;
+    limits->mMax0hbit = nCenter0 + mTrackHalf0;
+    return true;
+}
+
+bool SSDDecoderBase::ConfirmRecovery(U8 nChecksum)
+{
+    // Fin du paquet: checksum recu et donnees dans mCarData
+    bool bValid = (nChecksum == mCalculatedChecksum);
+    U8 nCount = (mCarCount < SSD_DATA_BYTES_MAX) ? mCarCount : SSD_DATA_BYTES_MAX;
+
+    if (bValid && mRecovered && mCurrentMode == SSD_MODE_PROGRAM) {
+        // PROGRAM est envoye deux fois, avec l'ID de la voiture 6 fois
+        if (mLastProgramValid)
+            bValid = (memcmp(mLastProgram, mCarData, nCount) == 0);
+        else
+            for (U8 i = 1; i < nCount; i++)
+                bValid = bValid && (mCarData[i] == mCarData[0]);
+    }
+
+    mLastProgramValid = bValid && mCurrentMode == SSD_MODE_PROGRAM;
+    if (mLastProgramValid)
+        memcpy(mLastProgram, mCarData, nCount);
+    return bValid;
+}
+
+UINT SSDDecoderBase::ClassifyHBitExact(UINT nHBitLen) const
+{
+    if (nHBitLen >= mLimits.mMin1hbit && nHBitLen <= mLimits.mMax1hbit)
+        return HBIT_1;
+    else if (nHBitLen >= mLimits.mMin0hbit && nHBitLen <= mLimits.mMax0hbit)
+        return HBIT_0;
+    else if (nHBitLen >= mLimits.mMinPEHold && nHBitLen <= mLimits.mMaxPGap)
+        return HBIT_GAP; // Packet gap
+    else
+        return HBIT_ERR; // bit error
+}
+
+UINT SSDDecoderBase::ClassifyHBit(UINT nHBitLen) const
+{
+    // Everything past the table is longer than mLimits.mMaxPGap: clamp onto the last (error) entry
+    U32 nIndex = nHBitLen >> mHBitShift;
+    nIndex = (nIndex < mHBitTableLast) ? nIndex : mHBitTableLast;
+
+    UINT nClass = mHBitTable[nIndex];
+    if (nClass == HBIT_SPLIT)
+        nClass = ClassifyHBitExact(nHBitLen);
+    return nClass;
+}
+
+void SSDDecoderBase::BuildHBitTable()
+{
+    // Quantize so the table covers 0..mLimits.mMaxPGap in at most HBIT_TABLE_MAX entries
+    mHBitShift = 0;
+    while ((mLimits.mMaxPGap >> mHBitShift) + 2 > HBIT_TABLE_MAX)
+        mHBitShift++;
+
+    U32 nEntries = (mLimits.mMaxPGap >> mHBitShift) + 2;
+    mHBitTable.resize(nEntries);
+    mHBitTableLast = nEntries - 1;
+
+    // First length of each class change; a bucket containing one of them is
+    // left to the exact comparisons
+    U64 nLimits[6] = { mLimits.mMin1hbit, (U64)mLimits.mMax1hbit + 1, mLimits.mMin0hbit, (U64)mLimits.mMax0hbit + 1,
+                       mLimits.mMinPEHold, (U64)mLimits.mMaxPGap + 1 };
+
+    for (U32 i = 0; i < nEntries; i++) {
+        U64 nLow = (U64)i << mHBitShift;
+        U64 nHigh = nLow + ((U64)1 << mHBitShift) - 1;
+        U8 nClass = (U8)ClassifyHBitExact((UINT)nLow);
+
+        for (int j = 0; j < 6; j++) {
+            if (nLimits[j] > nLow && nLimits[j] <= nHigh)
+                nClass = HBIT_SPLIT;
+        }
+        mHBitTable[i] = nClass;
+    }
+}
+
+U8 SSDDecoderBase::GetDataBytes(U8 nCommand)
+{
+    for (size_t i = 0; i < sizeof(sLayouts) / sizeof(sLayouts[0]); i++) {
+        if (sLayouts[i].mCommand == nCommand)
+            return sLayouts[i].mDataBytes;
+    }
+    return SSD_DATA_BYTES_UNKNOWN;
+}
+
+void SSDDecoderBase::PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2)
+{
+    if (mHolding)
+        HoldEvent(nStartSample, nEndSample, (U8)ft, Flags, Data1, Data2);
+    else
+        mOutput->OnFrame(nStartSample, nEndSample, ft, Flags, Data1, Data2, mCurrentMode);
+}
+
+void SSDDecoderBase::AddMarker(U64 nSample, eMarkerType marker)
+{
+    if (mHolding)
+        HoldEvent(nSample, nSample, SSD_HELD_MARKER, (U8)marker, 0, 0);
+    else
+        mOutput->OnMarker(nSample, marker);
+}
+
+void SSDDecoderBase::HoldEvent(U64 nStartSample, U64 nEndSample, U8 nType, U8 Flags, U64 Data1, U64 Data2)
+{
+    SSDHeldEvent& event = mHeld[mHeldCount++];
+    event.mStart = nStartSample;
+    event.mEnd = nEndSample;
+    event.mData1 = Data1;
+    event.mData2 = Data2;
+    event.mType = nType;
+    event.mFlags = Flags;
+    event.mPacketMode = mCurrentMode;
+
+    // Ne devrait pas arriver: le paquet part tel quel
+    if (mHeldCount == SSD_HELD_EVENTS_MAX)
+        ReleasePacket();
+}
+
+void SSDDecoderBase::ReleasePacket()
+{
+    // Paquet complet: la serie d'erreurs qui le precede est terminee
+    mHolding = false;
+    FlushErrors();
+
+    for (U32 i = 0; i < mHeldCount; i++) {
+        const SSDHeldEvent& event = mHeld[i];
+        if (event.mType == SSD_HELD_MARKER)
+            mOutput->OnMarker(event.mStart, (eMarkerType)event.mFlags);
+        else
+            mOutput->OnFrame(event.mStart, event.mEnd, (eFrameType)event.mType, event.mFlags,
+                             event.mData1, event.mData2, event.mPacketMode);
+    }
+    mHeldCount = 0;
+}
+
+void SSDDecoderBase::HoldRecovery()
+{
+    // L'octet en cours n'est pas encore poste: tout ce qui suit est retenu
+    mRecoverPending = true;
+    mRecoverStart = mFrameStart;
+    mRecoverHeld = mHeldCount;
+    mHolding = true;
+}
+
+void SSDDecoderBase::RejectRecovery(U64 nEndSample)
+{
+    // Les evenements depuis l'octet corrige deviennent l'erreur de bit
+    mRecoverPending = false;
+    if (AddErrorToSpan(mRecoverStart, nEndSample, BIT_ERROR_FLAG))
+        return;
+
+    mHeldCount = mRecoverHeld;
+    ReleasePacket();
+    mOutput->OnFrame(mRecoverStart, nEndSample, FRAME_ERR, BIT_ERROR_FLAG, 0, 0, mCurrentMode);
+    if (mFeatures & SSD_FEATURE_MARKERS) {
+        mOutput->OnMarker(mRecoverStart, MARKER_ERROR_SQUARE);
+        mOutput->OnMarker(nEndSample, MARKER_ERROR_X);
+    }
+}
+
+bool SSDDecoderBase::AddErrorToSpan(U64 nStartSample, U64 nEndSample, U8 Flags)
+{
+    // Toutes les erreurs passent par ici, avec ou sans resync.
+    // Un gap (HBIT_GAP = 3) est sa propre classe, pas le flag 0 + BIT_ERROR_FLAG.
+    mStats.mErrorEvents++;
+    if (Flags == HBIT_GAP)
+        mStats.mErrors[0]++;
+    else {
+        for (int i = 0; i < 8; i++)
+            mStats.mErrors[i] += (Flags >> i) & 1;
+    }
+    mLostSync = true;
+
+    if (!mResync)
+        return false;
+
+    // Le debut du paquet interrompu rejoint la serie
+    if (mErrCount == 0)
+        mErrStart = (mHeldCount != 0) ? mHeld[0].mStart : nStartSample;
+    mHolding = false;
+    mHeldCount = 0;
+
+    // Posee avec le prochain paquet complet
+    mErrEnd = nEndSample;
+    mErrFlags |= Flags;
+    mErrCount++;
+    return true;
+}
+
+void SSDDecoderBase::FlushErrors()
+{
+    if (mErrCount == 0)
+        return;
+
+    // Jamais retenue: les erreurs precedent le paquet en cours
+    mOutput->OnFrame(mErrStart, mErrEnd, FRAME_ERR_SPAN, mErrFlags, mErrCount, 0, mCurrentMode);
+    if (mFeatures & SSD_FEATURE_MARKERS) {
+        mOutput->OnMarker(mErrStart, MARKER_ERROR_SQUARE);
+        mOutput->OnMarker(mErrEnd, MARKER_ERROR_X);
+    }
+    mErrCount = 0;
+    mErrFlags = 0;
+}
+
+void SSDDecoderBase::Reset(U64 nStartSample)
+{
+    mState = FSTATE_INIT;
+    mHBitCnt = 0;
+    mHBitVal = 0;
+    mFrameStart = nStartSample;
+    mCurSample = nStartSample;
+    mPreambleStart = 0;
+
+    mCurrentMode = 0;
+    mCarCount = 0;
+    mDataBytes = 0;
+    mCalculatedChecksum = 0;
+
+    mErrCount = 0;
+    mErrFlags = 0;
+    mErrStart = 0;
+    mErrEnd = 0;
+    mHolding = false;
+    mHeldCount = 0;
+
+    mRecovered = false;
+    mRecoverPending = false;
+    mRecoverStart = 0;
+    mRecoverHeld = 0;
+    mLastProgramValid = false;
+    mLostSync = false;
+}
+
+void SSDDecoderBase::ResetIdle(U64 nSample)
+{
+    // Ce que laisse FSTATE_PEBIT une fois le gap et le demi-bit suivant lus
+    Reset(nSample);
+    mFrameStart = nSample + 1;
+    mPreambleStart = mFrameStart;
+}
@@ -0,0 +1,706 @@
+#ifndef SSD_DECODER_H
+#define SSD_DECODER_H
+
+#include <chrono>
+#include <vector>
+#include "SSDProtocol.h"
+#include "SSDEdgeReader.h"
+#include "SSDStats.h"
+
+typedef unsigned int UINT;
+
+// SSD Protocol constants
+#define SSD_MODE_PROGRAM 0x01
+#define SSD_MODE_RACE    0x02
+
+#define HBIT_TABLE_MAX 65536        // Max entries in the classification table
+#define SSD_TRACK_SHIFT 4           // Suivi de derive: poids 1/16 de chaque paquet dans la moyenne
+
+enum eFrameState {
+    FSTATE_INIT,
+    FSTATE_PREAMBLE,
+    FSTATE_PSBIT,
+    FSTATE_CMDBYTE,
+    FSTATE_DSBIT,
+    FSTATE_DSBIT_CHECKSUM,  // Bit start avant checksum
+    FSTATE_DATABYTE,
+    FSTATE_CHECKSUM,
+    FSTATE_PEBIT            // Dernier etat: SSD_STATS_STATES = FSTATE_PEBIT + 1
+};
+
+// Packet fields after the preamble, indexed by eFrameState: each of these
+// states reads one start bit or one byte, posts mFrame and goes to mNext
+enum eFieldKind {
+    FIELD_NONE,             // Etat traite directement par Step()
+    FIELD_START_BIT,
+    FIELD_BYTE
+};
+
+struct SSDField
+{
+    U8 mKind;               // eFieldKind
+    U8 mFrame;              // eFrameType posted once the field is read
+    U8 mNext;               // eFrameState after it (data bytes: see SSDPacketLayout)
+};
+
+// Number of data bytes between the command and the checksum of a packet
+struct SSDPacketLayout
+{
+    U8 mCommand;
+    U8 mDataBytes;
+};
+
+#define SSD_DATA_BYTES_MAX      6
+#define SSD_DATA_BYTES_UNKNOWN  1   // Commande inconnue: checksum apres le premier octet
+
+// Frame or marker of the packet being decoded, held back in resync mode until
+// the checksum tells whether it is posted or folded into the error span
+struct SSDHeldEvent
+{
+    U64 mStart, mEnd;
+    U64 mData1, mData2;
+    U8 mType;                       // eFrameType, or SSD_HELD_MARKER
+    U8 mFlags;                      // Frame flags, or eMarkerType
+    U8 mPacketMode;
+};
+
+#define SSD_HELD_MARKER     0xFF
+#define SSD_HELD_EVENTS_MAX 32      // Paquet complet: 26 au plus
+
+// Optional outputs of SSDDecoder, chosen at compile time: the calls for the
+// ones left out are not generated
+#define SSD_FEATURE_MARKERS     (1 << 0)    // OnMarker
+#define SSD_FEATURE_PROGRESS    (1 << 1)    // OnProgress
+#define SSD_FEATURE_PROFILE     (1 << 2)    // Steps and time per state in SSDDecoderStats
+#define SSD_FEATURES_ALL        (SSD_FEATURE_MARKERS | SSD_FEATURE_PROGRESS | SSD_FEATURE_PROFILE)
+
+// Receives everything the state machine produces. SSDAnalyzer forwards it to
+// mResults; the parallel decoder buffers it per chunk.
+class SSDDecoderOutput
+{
+public:
+    virtual ~SSDDecoderOutput() {}
+
+    // nPacketMode: commande du paquet en cours (couleur des donnees voitures)
+    virtual void OnFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2, U8 nPacketMode) = 0;
+    virtual void OnMarker(U64 nSample, eMarkerType marker) = 0;
+    virtual void OnProgress(U64 nSample) = 0;
+};
+
+// Timing, half-bit classification and state of the SSD decoder: everything
+// that does not depend on where the edges come from.
+class SSDDecoderBase
+{
+public:
+    SSDDecoderBase();
+    ~SSDDecoderBase();
+
+    static SSDHBitLimits GetTimingLimits(U32 nSampleRateHz, bool bTolerant, int nCalPPM, double dSkew = 1.0);   // Limits of the SSD timing modes, dSkew from SSDCalibration
+    const SSDHBitLimits& GetLimits() const { return mLimits; }
+    void SetPreambleBits(U32 nPreambleBits) { mPreambleBits = nPreambleBits; }
+    void SetOutput(SSDDecoderOutput* output) { mOutput = output; }
+    SSDDecoderOutput* GetOutput() const { return mOutput; }
+    void SetResync(bool bResync) { mResync = bResync; }     // Erreurs consecutives en une FRAME_ERR_SPAN
+    void FlushErrors();                 // Poste la FRAME_ERR_SPAN en cours
+    bool HasErrorSpan() const { return mErrCount != 0; }
+
+    // Drift tracking (timing mode "Adaptive"): the windows set by SetTiming
+    // follow the half-bit lengths measured on good packets, they keep their
+    // width and stay within bounds (the tolerant limits)
+    void SetTracking(bool bTracking, const SSDHBitLimits& bounds);
+    bool IsTracking() const { return mTracking; }
+
+    // Single-bit recovery: one half-bit per packet lying between the '1' and
+    // '0' windows takes the value of the other half-bit of its bit. The
+    // packet is kept (RECOVERED_FLAG) only if the checksum agrees and, for
+    // PROGRAM, the car ID agrees with the PROGRAM packet just before it, or
+    // its 6 copies agree with each other. Its events are held from the byte
+    // with the guess until then; otherwise they are replaced by the bit
+    // error the half-bit was.
+    void SetRecovery(bool bRecovery) { mRecovery = bRecovery; }
+
+    void Reset(U64 nStartSample);       // Etat de debut de capture
+    void ResetIdle(U64 nSample);        // Etat apres le gap qui suit un paquet
+
+    UINT ClassifyHBitExact(UINT nHBitLen) const;
+    UINT ClassifyHBit(UINT nHBitLen) const;
+
+protected:
+    void SetLimits(const SSDHBitLimits& limits);
+    void BuildHBitTable();
+    void PostFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2);
+    bool AddErrorToSpan(U64 nStartSample, U64 nEndSample, U8 Flags);
+    void AddMarker(U64 nSample, eMarkerType marker);
+    void HoldEvent(U64 nStartSample, U64 nEndSample, U8 nType, U8 Flags, U64 Data1, U64 Data2);
+    void ReleasePacket();
+    void HoldRecovery();
+    void RejectRecovery(U64 nEndSample);
+    void ReportProgress(U64 nSample) { mOutput->OnProgress(nSample); }
+
+    // Longueurs du paquet en cours, pour le suivi de derive
+    void TrackStartBit(U64 nLength, bool bFirst)
+    {
+        if (bFirst) {
+            mTrackZeroLen = 0;
+            mTrackZeroBits = 0;
+            mTrackByteLen = 0;
+            mTrackByteOnes = 0;
+        }
+        mTrackZeroLen += nLength;
+        mTrackZeroBits++;
+    }
+    void TrackByte(U8 nVal, U64 nLength)
+    {
+        U32 nOnes = nVal - ((nVal >> 1) & 0x55);
+        nOnes = (nOnes & 0x33) + ((nOnes >> 2) & 0x33);
+        mTrackByteOnes += (nOnes + (nOnes >> 4)) & 0x0F;
+        mTrackByteLen += nLength;
+    }
+    bool TrackPacket(SSDHBitLimits* limits);
+
+    bool IsMarginalHBit(U64 nLength) const
+    {
+        return nLength > mLimits.mMax1hbit && nLength < mLimits.mMin0hbit;
+    }
+    bool ConfirmRecovery(U8 nChecksum);
+
+    static U8 GetDataBytes(U8 nCommand);
+
+    static const SSDField sFields[];
+    static const SSDPacketLayout sLayouts[];
+
+protected: //vars
+    SSDDecoderOutput* mOutput;
+    U32 mFeatures;                  // SSD_FEATURE_* of the SSDDecoder
+
+    // Timing parameters
+    SSDHBitLimits mLimits;
+    U32 mPreambleBits;
+
+    // Half-bit classification table, indexed by (length >> mHBitShift)
+    std::vector<U8> mHBitTable;
+    U32 mHBitShift;
+    U32 mHBitTableLast;
+
+    // State machine
+    eFrameState mState;
+    U32 mHBitCnt;
+    U8  mHBitVal;
+    U64 mFrameStart;
+    U64 mCurSample;
+    U64 mPreambleStart;
+
+    // SSD protocol state - RACE et PROGRAM ont tous les deux 6 bytes de donnees
+    U8 mCurrentMode;              // Current packet mode (RACE/PROGRAM)
+    U8 mCarCount;                 // Current car being processed (0-5 pour 6 bytes)
+    U8 mDataBytes;                // Data bytes of the current packet (sLayouts)
+    U8 mCalculatedChecksum;       // Calculated checksum (starts at 0xFF)
+    U8 mCarData[SSD_DATA_BYTES_MAX];   // Car data storage (6 bytes pour RACE et PROGRAM)
+
+    // Resync mode: errors since the last complete packet, and the events of
+    // the packet being decoded
+    bool mResync;
+    U32 mErrCount;
+    U8 mErrFlags;
+    U64 mErrStart, mErrEnd;
+    bool mHolding;
+    U32 mHeldCount;
+    SSDHeldEvent mHeld[SSD_HELD_EVENTS_MAX];
+
+    // Drift tracking: estimates in 1/256 sample, windows as centre +/- half width
+    bool mTracking;
+    SSDHBitLimits mTrackBounds;
+    U64 mTrackEst1, mTrackEst0;
+    U32 mTrackCenter1, mTrackCenter0;
+    U32 mTrackHalf1, mTrackHalf0;
+    U64 mTrackZeroLen;              // Bits start ('0' seuls) du paquet en cours
+    U32 mTrackZeroBits;
+    U64 mTrackByteLen;              // Octets du paquet en cours
+    U32 mTrackByteOnes;
+
+    // Counters (SSDStats.h); edges and half-bits are counted by mEdges
+    SSDDecoderStats mStats;
+    bool mLostSync;                 // Erreur depuis le dernier preambule complet
+
+    // Single-bit recovery
+    bool mRecovery;
+    bool mRecovered;                // Un bit corrige dans le paquet en cours
+    bool mRecoverPending;           // ... pas encore confirme par le checksum
+    U64 mRecoverStart;              // Debut de l'octet qui le contient
+    U32 mRecoverHeld;               // Premier evenement retenu de cet octet
+    bool mLastProgramValid;         // Le paquet precedent etait un PROGRAM valide
+    U8 mLastProgram[SSD_DATA_BYTES_MAX];
+};
+
+// SSD protocol state machine, fed by an SSDEdgeReader over any edge source
+// (SSDEdgeSource.h). All the state lives in members so decoding can be
+// stopped after any Step() and resumed, or copied to decode another part of
+// the capture.
+// nFeatures (SSD_FEATURE_*) drops the outputs nobody reads, e.g. markers and
+// progress for an offline decode.
+template <class Source, U32 nFeatures = SSD_FEATURES_ALL>
+class SSDDecoder : public SSDDecoderBase
+{
+public:
+    SSDDecoder() { mFeatures = nFeatures; }
+
+    void SetTiming(U32 nSampleRateHz, bool bTolerant, int nCalPPM, double dSkew = 1.0) { SetLimits(GetTimingLimits(nSampleRateHz, bTolerant, nCalPPM, dSkew)); }
+    void SetLimits(const SSDHBitLimits& limits)
+    {
+        SSDDecoderBase::SetLimits(limits);
+        mEdges.SetLimits(limits);
+    }
+    SSDEdgeReader<Source>& GetEdges() { return mEdges; }
+    const SSDEdgeReader<Source>& GetEdges() const { return mEdges; }
+
+    bool IsIdleAt(U64 nSample) const;   // Etat identique a ResetIdle(nSample) ?
+    void Step();                        // Une iteration de la machine d'etat
+
+    // Counters since ClearStats(). A parallel chunk starts from cleared
+    // counters and adds the ones of the chunk before it once it is merged.
+    void GetStats(SSDDecoderStats* stats) const
+    {
+        *stats = mStats;
+        mEdges.GetCounts(&stats->mEdges, stats->mHBits);
+    }
+    void AddStats(const SSDDecoder& decoder)
+    {
+        mStats.Add(decoder.mStats);
+        mEdges.AddCounts(decoder.mEdges);
+    }
+    void ClearStats()
+    {
+        mStats.Clear();
+        mEdges.ClearCounts();
+    }
+
+protected:
+    void StepState();
+    UINT LookaheadNextHBit(U64* nSample);
+    UINT GetNextHBit(U64* nSample);
+    UINT GetNextBit(U64* nSample);
+    UINT RecoverNextBit(U64* nSample);
+    void ReadStartBit(const SSDField& field);
+    void ReadByte(const SSDField& field);
+    void EndByte(const SSDField& field, U8 nVal, U8 nFlags);
+
+    void Mark(U64 nSample, eMarkerType marker)
+    {
+        if (nFeatures & SSD_FEATURE_MARKERS)
+            AddMarker(nSample, marker);
+    }
+    void Progress(U64 nSample)
+    {
+        if (nFeatures & SSD_FEATURE_PROGRESS)
+            ReportProgress(nSample);
+    }
+
+protected: //vars
+    SSDEdgeReader<Source> mEdges;   // Buffered edge intervals
+};
+
+template <class Source, U32 nFeatures>
+UINT SSDDecoder<Source, nFeatures>::LookaheadNextHBit(U64* nSample)
+{
+    U64 nNextEdge = mEdges.GetSampleOfNextEdge();
+
+    // Cas normal: on part du dernier front lu, la classe est deja calculee
+    if (*nSample == mEdges.GetSampleNumber()) {
+        *nSample = nNextEdge;
+        return mEdges.GetClassOfNextEdge();
+    }
+
+    UINT nHBitLen = (UINT)(nNextEdge - *nSample);
+    *nSample = nNextEdge;
+
+    return ClassifyHBit(nHBitLen);
+}
+
+template <class Source, U32 nFeatures>
+UINT SSDDecoder<Source, nFeatures>::GetNextHBit(U64* nSample)
+{
+    U64 nSampNumber = *nSample;
+    UINT nClass;
+
+    if (nSampNumber == mEdges.GetSampleNumber()) {
+        nClass = mEdges.GetClassOfNextEdge();
+        mEdges.AdvanceToNextEdge();
+        *nSample = mEdges.GetSampleNumber();
+    }
+    else {
+        mEdges.AdvanceToNextEdge();
+        *nSample = mEdges.GetSampleNumber();
+        nClass = ClassifyHBit((UINT)(*nSample - nSampNumber));
+    }
+
+    // Pas de gap au milieu d'un paquet
+    return (nClass == HBIT_GAP) ? HBIT_ERR : nClass;
+}
+
+template <class Source, U32 nFeatures>
+UINT SSDDecoder<Source, nFeatures>::GetNextBit(U64* nSample)
+{
+    // Les deux demi-bits sont deja apparies par le kernel
+    if (*nSample == mEdges.GetSampleNumber() && mEdges.IsNextPairReady()) {
+        UINT nBit = mEdges.GetBitOfNextPair();
+        mEdges.AdvancePair();
+        *nSample = mEdges.GetSampleNumber();
+        return nBit;
+    }
+
+    U64 nTemp = *nSample;
+    UINT nHBit1 = GetNextHBit(nSample);
+    UINT nHBit2 = GetNextHBit(nSample);
+
+    if ((nHBit1 > 1) || (nHBit2 > 1) || ((UINT)(*nSample - nTemp) > mLimits.mMaxBitLen))
+        return BIT_ERROR_FLAG;      // bit error
+    else if (nHBit1 != nHBit2)
+        return FRAMING_ERROR_FLAG;  // frame error
+    else
+        return nHBit1;
+}
+
+template <class Source, U32 nFeatures>
+UINT SSDDecoder<Source, nFeatures>::RecoverNextBit(U64* nSample)
+{
+    // GetNextBit, plus un demi-bit entre les fenetres par paquet
+    U64 nStart = *nSample;
+    UINT nHBit1 = GetNextHBit(nSample);
+    U64 nMiddle = *nSample;
+    UINT nHBit2 = GetNextHBit(nSample);
+
+    if ((UINT)(*nSample - nStart) > mLimits.mMaxBitLen)
+        return BIT_ERROR_FLAG;
+    if (nHBit1 <= 1 && nHBit2 <= 1)
+        return (nHBit1 == nHBit2) ? nHBit1 : FRAMING_ERROR_FLAG;
+    if (mRecovered)
+        return BIT_ERROR_FLAG;
+
+    // L'autre interpretation donnerait deux demi-bits differents
+    if (nHBit1 <= 1 && IsMarginalHBit(*nSample - nMiddle))
+        mRecovered = true;
+    else if (nHBit2 <= 1 && IsMarginalHBit(nMiddle - nStart))
+        mRecovered = true;
+    else
+        return BIT_ERROR_FLAG;
+
+    return (nHBit1 <= 1) ? nHBit1 : nHBit2;
+}
+
+template <class Source, U32 nFeatures>
+bool SSDDecoder<Source, nFeatures>::IsIdleAt(U64 nSample) const
+{
+    // Le reste de l'etat est reinitialise avant d'etre lu (PSBIT / CMDBYTE).
+    // Un PROGRAM juste avant: le chunk suivant est refait en serie.
+    return mState == FSTATE_INIT && mHBitCnt == 0 &&
+        mCurSample == nSample && mEdges.GetSampleNumber() == nSample &&
+        mFrameStart == nSample + 1 && mPreambleStart == nSample + 1 && mErrCount == 0 &&
+        !mLastProgramValid && !mLostSync;
+}
+
+template <class Source, U32 nFeatures>
+void SSDDecoder<Source, nFeatures>::Step()
+{
+    if (!(nFeatures & SSD_FEATURE_PROFILE)) {
+        StepState();
+        return;
+    }
+
+    // Un pas sur SSD_PROFILE_PERIOD est chronometre, les autres seulement comptes
+    eFrameState nState = mState;
+    if ((mStats.mSteps[nState]++ & (SSD_PROFILE_PERIOD - 1)) != 0) {
+        StepState();
+        return;
+    }
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    StepState();
+    U64 nNs = (U64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    U64 nOverhead = SSDProfileOverheadNs();
+    mStats.mStateNs[nState] += SSD_PROFILE_PERIOD * ((nNs > nOverhead) ? nNs - nOverhead : 0);
+}
+
+template <class Source, U32 nFeatures>
+void SSDDecoder<Source, nFeatures>::StepState()
+{
+    U64 nBitStartSample = mCurSample;
+    U64 nTemp;
+
+    // Preambule et fin de paquet ici, le reste du paquet par ReadStartBit / ReadByte
+    switch (mState)
+    {
+    case FSTATE_INIT:
+        if (mCurSample == mEdges.GetSampleNumber()) {
+            // Saute d'un coup jusqu'a la fin du prochain preambule
+            U64 nRunStart = 0;
+            U8 nLast = mEdges.ScanHBitRun(&mHBitCnt, mPreambleBits * 2, &nRunStart);
+
+            if (nLast != HBIT_SPLIT) {
+                mHBitVal = (nLast == HBIT_GAP) ? HBIT_ERR : nLast;
+                mCurSample = mEdges.GetSampleNumber();
+                if (nRunStart != 0) {
+                    mFrameStart = nRunStart;
+                    mPreambleStart = nRunStart;
+                }
+                if (mHBitCnt == (mPreambleBits * 2))
+                    mState = FSTATE_PREAMBLE;
+                break;
+            }
+        }
+
+        mHBitVal = GetNextHBit(&mCurSample);
+        switch (mHBitVal)
+        {
+        case 1:
+            ++mHBitCnt;
+            if (mHBitCnt == (mPreambleBits * 2)) {
+                mState = FSTATE_PREAMBLE;
+            }
+            break;
+        default:
+            mHBitCnt = 0;
+            mFrameStart = mCurSample + 1;
+            mPreambleStart = mFrameStart;
+            break;
+        }
+        break;
+
+    case FSTATE_PREAMBLE:
+        // Le reste du preambule d'un coup, jusqu'au bit start
+        if (mCurSample == mEdges.GetSampleNumber()) {
+            mHBitCnt += mEdges.SkipHBitOnes();
+            mCurSample = mEdges.GetSampleNumber();
+            nBitStartSample = mCurSample;
+        }
+
+        nTemp = mCurSample;
+        mHBitVal = LookaheadNextHBit(&nTemp);
+        switch (mHBitVal) {
+        case 0: // Start bit ends preamble
+            if (mLostSync) {
+                mStats.mResyncs++;
+                mLostSync = false;
+            }
+            mHolding = mResync;
+            PostFrame(mPreambleStart, mCurSample, FRAME_PREAMBLE, 0, mHBitCnt / 2, 0);
+            Progress(mCurSample);
+            mFrameStart = mCurSample + 1;
+            mState = FSTATE_PSBIT;
+            break;
+        case 1:
+            mHBitVal = GetNextHBit(&mCurSample);
+            ++mHBitCnt;
+            break;
+        default:
+            if (!AddErrorToSpan(nBitStartSample, mCurSample, mHBitVal)) {
+                PostFrame(nBitStartSample, mCurSample, FRAME_ERR, mHBitVal, 0, 0);
+                Mark(nBitStartSample, MARKER_ERROR_SQUARE);
+                Mark(mCurSample, MARKER_ERROR_X);
+            }
+            Progress(mCurSample);
+            mHBitCnt = 0;
+            mState = FSTATE_INIT;
+        }
+        break;
+
+    case FSTATE_PEBIT:
+    {
+        // Bloc pour isoler la portee de la variable lookahead
+        // Apres le checksum, chercher le gap entre paquets ou le debut du prochain
+        nTemp = mCurSample;
+        UINT lookahead = LookaheadNextHBit(&nTemp);
+
+        if (lookahead == HBIT_GAP) {
+            // Packet gap detecte - fin normale de paquet
+            PostFrame(mFrameStart, mCurSample, FRAME_PEBIT, 0, 0, 0);
+            Mark(mFrameStart, MARKER_STOP);
+            Progress(mCurSample);
+
+            // Avancer jusqu'a la fin du gap
+            while (LookaheadNextHBit(&mCurSample) == HBIT_GAP) {
+                GetNextHBit(&mCurSample);
+            }
+
+            mFrameStart = mCurSample + 1;
+            mPreambleStart = mFrameStart;
+            mHBitCnt = 0;
+            mState = FSTATE_INIT;
+        }
+        else if (lookahead == 1) {
+            // Debut immediat du prochain paquet (preamble)
+            PostFrame(mFrameStart, mCurSample, FRAME_PEBIT, 0, 0, 0);
+            Mark(mFrameStart, MARKER_STOP);
+            Progress(mCurSample);
+
+            mFrameStart = mCurSample + 1;
+            mPreambleStart = mFrameStart;
+            mHBitCnt = 1; // On a deja vu le premier bit '1' du preambule
+            mState = FSTATE_INIT;
+        }
+        else {
+            // Erreur ou bit inattendu
+            if (!AddErrorToSpan(mFrameStart, mCurSample, BIT_ERROR_FLAG)) {
+                PostFrame(mFrameStart, mCurSample, FRAME_ERR, BIT_ERROR_FLAG, 0, 0);
+                Mark(mFrameStart, MARKER_ERROR_X);
+            }
+            Progress(mCurSample);
+            mHBitCnt = 0;
+            mState = FSTATE_INIT;
+        }
+    }
+    break;
+
+    default:
+        // Bits start et octets du paquet: decrits par sFields
+        switch (sFields[mState].mKind) {
+        case FIELD_START_BIT:
+            ReadStartBit(sFields[mState]);
+            break;
+        case FIELD_BYTE:
+            ReadByte(sFields[mState]);
+            break;
+        default:
+            mHBitCnt = 0;
+            mState = FSTATE_INIT;
+        }
+    }
+}
+
+template <class Source, U32 nFeatures>
+void SSDDecoder<Source, nFeatures>::ReadStartBit(const SSDField& field)
+{
+    U64 nBitStartSample = mCurSample;
+
+    mHBitVal = GetNextBit(&mCurSample);
+    mHBitCnt = 0;
+    if (mHBitVal == 0) {
+        if (field.mFrame == FRAME_PSBIT)
+            mRecovered = false;
+        if (mTracking)
+            TrackStartBit(mCurSample - nBitStartSample, field.mFrame == FRAME_PSBIT);
+        PostFrame(mFrameStart, mCurSample, (eFrameType)field.mFrame, 0, 0, 0);
+        Mark(mFrameStart, MARKER_START);
+        Progress(mCurSample);
+        mFrameStart = mCurSample + 1;
+        mState = (eFrameState)field.mNext;
+    }
+    else {
+        if (mRecoverPending)
+            RejectRecovery(nBitStartSample);
+        if (!AddErrorToSpan(nBitStartSample, mCurSample, FRAMING_ERROR_FLAG)) {
+            PostFrame(nBitStartSample, mCurSample, FRAME_ERR, FRAMING_ERROR_FLAG, 0, 0);
+            Mark(nBitStartSample, MARKER_ERROR_DOT);
+        }
+        Progress(mCurSample);
+        mState = FSTATE_INIT;
+    }
+}
+
+template <class Source, U32 nFeatures>
+void SSDDecoder<Source, nFeatures>::ReadByte(const SSDField& field)
+{
+    U32 nVal = 0;
+
+    // Les 8 bits d'un coup quand ils sont deja apparies et sans erreur
+    if (mCurSample == mEdges.GetSampleNumber() && mEdges.ReadPairByte(&nVal)) {
+        mCurSample = mEdges.GetSampleNumber();
+        EndByte(field, (U8)nVal, 0);
+        return;
+    }
+
+    bool bRecovered = mRecovered;
+    for (U32 i = 0; i < 8; i++) {
+        U64 nBitStartSample = mCurSample;
+
+        mHBitVal = mRecovery ? RecoverNextBit(&mCurSample) : GetNextBit(&mCurSample);
+        if (mRecovered != bRecovered && !mRecoverPending)
+            HoldRecovery();
+        if (mHBitVal > 1) {
+            if (mRecoverPending)
+                RejectRecovery(nBitStartSample);
+            if (!AddErrorToSpan(nBitStartSample, mCurSample, mHBitVal)) {
+                PostFrame(nBitStartSample, mCurSample, FRAME_ERR, mHBitVal, 0, 0);
+                Mark(nBitStartSample, MARKER_ERROR_SQUARE);
+                Mark(mCurSample, MARKER_ERROR_X);
+            }
+            Progress(mCurSample);
+            mHBitCnt = 0;
+            mState = FSTATE_INIT;
+            return;
+        }
+        nVal = (nVal << 1) | mHBitVal;
+    }
+
+    EndByte(field, (U8)nVal, (mRecovered != bRecovered) ? RECOVERED_FLAG : 0);
+}
+
+template <class Source, U32 nFeatures>
+void SSDDecoder<Source, nFeatures>::EndByte(const SSDField& field, U8 nVal, U8 nFlags)
+{
+    U64 nData2 = 0;
+    eFrameState nNext = (eFrameState)field.mNext;
+
+    if (mTracking)
+        TrackByte(nVal, mCurSample - mFrameStart + 1);
+
+    switch (field.mFrame) {
+    case FRAME_CMDBYTE:
+        mCurrentMode = nVal;    // Definir le mode pour tout le paquet
+        mCarCount = 0;
+        mDataBytes = GetDataBytes(nVal);
+        // CORRECTION CHECKSUM: 0xFF selon le protocole SSD reel, puis la commande
+        mCalculatedChecksum = 0xFF ^ nVal;
+        break;
+
+    case FRAME_CARDATA:
+        if (mCarCount < SSD_DATA_BYTES_MAX)     // Protection contre debordement
+            mCarData[mCarCount] = nVal;
+        mCalculatedChecksum ^= nVal;
+        nData2 = ++mCarCount;                   // Numero de voiture (1-6)
+
+        // Toujours un bit start avant le prochain octet (donnees ou checksum)
+        if (mCarCount >= mDataBytes)
+            nNext = FSTATE_DSBIT_CHECKSUM;
+        break;
+
+    case FRAME_CHECKSUM:
+        // Le checksum calcule inclut: 0xFF ⊕ Commande ⊕ Donnees voitures
+        nData2 = mCalculatedChecksum;
+        if (mRecovery ? !ConfirmRecovery(nVal) : (nVal != mCalculatedChecksum)) {
+            // Correction non confirmee: l'erreur de bit d'origine, pas de paquet
+            if (mRecoverPending) {
+                RejectRecovery(mCurSample);
+                Progress(mCurSample);
+                mHBitCnt = 0;
+                mState = FSTATE_INIT;
+                return;
+            }
+            nFlags |= CHECKSUM_ERROR_FLAG;
+            Mark(mFrameStart, MARKER_ERROR_X);
+            mStats.mChecksumErrors++;
+            break;
+        }
+
+        mStats.mPackets[mCurrentMode]++;
+        if (mRecoverPending) {
+            nFlags |= RECOVERED_FLAG;
+            mStats.mRecovered++;
+            mRecoverPending = false;
+        }
+        if (mTracking) {
+            SSDHBitLimits limits;
+            if (TrackPacket(&limits))
+                SetLimits(limits);
+        }
+        break;
+    }
+
+    PostFrame(mFrameStart, mCurSample, (eFrameType)field.mFrame, nFlags, nVal, nData2);
+    if (field.mFrame == FRAME_CHECKSUM && mHolding)
+        ReleasePacket();
+    Progress(mCurSample);
+    mFrameStart = mCurSample + 1;
+    mState = nNext;
+}
+
+#endif //SSD_DECODER_H
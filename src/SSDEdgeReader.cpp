@@ -0,0 +1,285 @@
+#include "SSDEdgeReader.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline U32 CountTrailingZeros(U64 nWord)     // nWord != 0
+{
+#ifdef _MSC_VER
+    unsigned long nIndex;
+    _BitScanForward64(&nIndex, nWord);
+    return (U32)nIndex;
+#else
+    return (U32)__builtin_ctzll(nWord);
+#endif
+}
+
+static inline U32 CountBits(U64 nWord)
+{
+#ifdef _MSC_VER
+    return (U32)__popcnt64(nWord);
+#else
+    return (U32)__builtin_popcountll(nWord);
+#endif
+}
+
+SSDEdgeRing::SSDEdgeRing()
+    : mHead(0),
+    mCount(0),
+    mCurSample(0),
+    mLongInterval(0),
+    mLoaded(0),
+    mScanLimit(~(U64)0),
+    mEdgeCount(0)
+{
+    memset(&mLimits, 0, sizeof(mLimits));
+    memset(mClassCount, 0, sizeof(mClassCount));
+}
+
+void SSDEdgeRing::Restart(U64 nStartSample)
+{
+    // Les intervalles pas encore consommes seront relus par la nouvelle source
+    U64 classes[4];
+    CountClasses(mHead, mHead + mCount, classes);
+    for (int i = 0; i < 4; i++)
+        mClassCount[i] -= classes[i];
+    mEdgeCount += GetConsumed();
+    if (mHistogram.IsEnabled())
+        mHistogram.Remove(mRing + mHead, mCount);
+
+    mHead = 0;
+    mCount = 0;
+    mCurSample = nStartSample;
+    mLongInterval = 0;
+    mLoaded = 0;
+    mScanLimit = ~(U64)0;
+}
+
+void SSDEdgeRing::SetLimits(const SSDHBitLimits& limits)
+{
+    // Suivi de derive: les limites changent au milieu d'un bloc
+    mLimits = limits;
+    if (mCount == 0)
+        return;
+
+    U64 classes[4];
+    CountClasses(mHead, mHead + mCount, classes);
+    for (int i = 0; i < 4; i++)
+        mClassCount[i] -= classes[i];
+
+    ClassifyRange(mHead, mHead + mCount);
+
+    CountClasses(mHead, mHead + mCount, classes);
+    for (int i = 0; i < 4; i++)
+        mClassCount[i] += classes[i];
+}
+
+void SSDEdgeRing::Classify()
+{
+    mLoaded += mCount;
+    ClassifyRange(0, mCount);
+
+    U64 classes[4];
+    CountClasses(0, mCount, classes);
+    for (int i = 0; i < 4; i++)
+        mClassCount[i] += classes[i];
+    if (mHistogram.IsEnabled())
+        mHistogram.Add(mRing, mCount);
+}
+
+void SSDEdgeRing::GetCounts(U64* nEdges, U64* classes) const
+{
+    CountClasses(mHead, mHead + mCount, classes);
+    for (int i = 0; i < 4; i++)
+        classes[i] = mClassCount[i] - classes[i];
+    *nEdges = mEdgeCount + GetConsumed();
+}
+
+void SSDEdgeRing::AddCounts(const SSDEdgeRing& ring)
+{
+    U64 nEdges;
+    U64 classes[4];
+    ring.GetCounts(&nEdges, classes);
+    for (int i = 0; i < 4; i++)
+        mClassCount[i] += classes[i];
+    mEdgeCount += nEdges;
+
+    if (mHistogram.IsEnabled() && ring.mHistogram.IsEnabled()) {
+        mHistogram.Add(ring.mHistogram);
+        mHistogram.Remove(ring.mRing + ring.mHead, ring.mCount);
+    }
+}
+
+void SSDEdgeRing::GetHistogram(SSDTimingHistogram* histogram) const
+{
+    *histogram = mHistogram;
+    if (mHistogram.IsEnabled())
+        histogram->Remove(mRing + mHead, mCount);
+}
+
+void SSDEdgeRing::ClearCounts()
+{
+    // Les intervalles en attente restent comptes: ils seront consommes
+    CountClasses(mHead, mHead + mCount, mClassCount);
+    mEdgeCount = 0 - GetConsumed();
+    mHistogram.Clear();
+    if (mHistogram.IsEnabled())
+        mHistogram.Add(mRing + mHead, mCount);
+}
+
+void SSDEdgeRing::CountClasses(U32 nFrom, U32 nTo, U64* classes) const
+{
+    // Classes sur 2 bits, 8 par mot: HBIT_1 = 01, HBIT_ERR = 10, HBIT_GAP = 11
+    U64 nOnes = 0, nErrors = 0, nGaps = 0;
+    U32 i = nFrom;
+    for (; i + 8 <= nTo; i += 8) {
+        U64 nClasses;
+        memcpy(&nClasses, mClass + i, sizeof(nClasses));
+        U64 nLow = nClasses & 0x0101010101010101ULL;
+        U64 nHigh = (nClasses >> 1) & 0x0101010101010101ULL;
+        nOnes += CountBits(nLow & ~nHigh);
+        nErrors += CountBits(nHigh & ~nLow);
+        nGaps += CountBits(nLow & nHigh);
+    }
+    for (; i < nTo; i++) {
+        nOnes += (mClass[i] == HBIT_1);
+        nErrors += (mClass[i] == HBIT_ERR);
+        nGaps += (mClass[i] == HBIT_GAP);
+    }
+
+    classes[HBIT_1] = nOnes;
+    classes[HBIT_ERR] = nErrors;
+    classes[HBIT_GAP] = nGaps;
+    classes[HBIT_0] = (nTo - nFrom) - nOnes - nErrors - nGaps;
+}
+
+void SSDEdgeRing::ClassifyRange(U32 nFrom, U32 nTo)
+{
+    SSDHBitKernel::Classify(mLimits, mRing + nFrom, mClass + nFrom, nTo - nFrom);
+    SSDHBitKernel::Pair(mLimits, mRing + nFrom, mClass + nFrom, mPair + nFrom, nTo - nFrom);
+
+    // Le decodeur travaille sur la longueur tronquee a 32 bits
+    if (mRing[nTo - 1] == INTERVAL_LONG) {
+        mClass[nTo - 1] = SSDHBitKernel::ClassifyOne(mLimits, (U32)mLongInterval);
+        if (nTo - nFrom >= 2)
+            mPair[nTo - 2] = SSDHBitKernel::PairOne(mLimits, mClass[nTo - 2], mClass[nTo - 1],
+                                                    (U32)(mRing[nTo - 2] + mLongInterval));
+    }
+
+    // Masque des demi-bits '1', 8 classes a la fois (little-endian).
+    // HBIT_1 est la seule classe avec le bit 0 a 1 et le bit 1 a 0.
+    // Les bits avant nFrom (deja consommes) ne sont jamais lus.
+    U32 nWords = (nTo + 63) / 64;
+    for (U32 w = nFrom / 64; w < nWords; w++) {
+        U64 nOnes = 0;
+        for (U32 j = 0; j < 8; j++) {
+            U64 nClasses;
+            memcpy(&nClasses, mClass + w * 64 + j * 8, sizeof(nClasses));
+            U64 nFlags = nClasses & ~(nClasses >> 1) & 0x0101010101010101ULL;
+            nOnes |= ((nFlags * 0x0102040810204080ULL) >> 56) << (j * 8);
+        }
+        mOnes[w] = nOnes;
+    }
+    if (nTo % 64 != 0)
+        mOnes[nWords - 1] &= ((U64)1 << (nTo % 64)) - 1;
+}
+
+U32 SSDEdgeRing::GetScanEnd() const
+{
+    // Les scans ne depassent pas mScanLimit (fin d'un chunk parallele)
+    U64 nConsumed = GetConsumed();
+    if (nConsumed >= mScanLimit)
+        return mHead;
+    return (mScanLimit - nConsumed < mCount) ? mHead + (U32)(mScanLimit - nConsumed) : mHead + mCount;
+}
+
+U32 SSDEdgeRing::CountOnes(U32 nFrom, U32 nTo) const
+{
+    // Premier zero du masque a partir de nFrom, un mot a la fois
+    U32 nPos = nFrom;
+    while (nPos < nTo) {
+        U64 nZeros = ~mOnes[nPos / 64] >> (nPos % 64);
+        if (nZeros != 0) {
+            nPos += CountTrailingZeros(nZeros);
+            break;
+        }
+        nPos = (nPos | 63) + 1;
+    }
+    return ((nPos < nTo) ? nPos : nTo) - nFrom;
+}
+
+U64 SSDEdgeRing::SumIntervals(U32 nFrom, U32 nTo) const
+{
+    U64 nSum = 0;
+    for (U32 i = nFrom; i < nTo; i++)
+        nSum += mRing[i];
+
+    // Un INTERVAL_LONG ne peut etre que le dernier du bloc
+    if (nTo > nFrom && mRing[nTo - 1] == INTERVAL_LONG)
+        nSum += mLongInterval - INTERVAL_LONG;
+    return nSum;
+}
+
+U8 SSDEdgeRing::ScanRun(U32* nRun, U32 nTarget, U64* nRunStart)
+{
+    U32 nEnd = GetScanEnd();
+    if (nEnd == mHead)
+        return HBIT_SPLIT;
+
+    // La serie en cours commence a nBegin avec nCarry '1' deja comptes.
+    // Chaque zero du masque (demi-bit autre que '1') la recommence.
+    U32 nBegin = mHead;
+    U32 nCarry = *nRun;
+    U32 nZero = nEnd;               // Dernier demi-bit autre que '1' consomme
+    U32 nPos = nEnd;
+
+    for (U32 nWord = mHead / 64; nWord * 64 < nEnd; nWord++) {
+        U32 nBase = nWord * 64;
+        U64 nZeros = ~mOnes[nWord];
+        if (nBase < mHead)
+            nZeros &= ~(U64)0 << (mHead - nBase);
+        if (nEnd - nBase < 64)
+            nZeros &= ((U64)1 << (nEnd - nBase)) - 1;
+
+        for (; nZeros != 0; nZeros &= nZeros - 1) {
+            U32 nIndex = nBase + CountTrailingZeros(nZeros);
+            if (nIndex - nBegin + nCarry >= nTarget)
+                break;
+            nZero = nIndex;
+            nBegin = nIndex + 1;
+            nCarry = 0;
+        }
+        if (nZeros != 0 || ((nEnd - nBase < 64) ? nEnd : nBase + 64) - nBegin + nCarry >= nTarget) {
+            nPos = nBegin + nTarget - nCarry;
+            break;
+        }
+    }
+
+    U32 n = (nPos - nBegin) + nCarry;
+    U8 nClass = mClass[nPos - 1];
+    U64 nLength = 0;
+    if (nZero != nEnd) {
+        nLength = SumIntervals(mHead, nZero + 1);
+        *nRunStart = mCurSample + nLength + 1;
+        nLength += SumIntervals(nZero + 1, nPos);
+    }
+    else {
+        nLength = SumIntervals(mHead, nPos);
+    }
+
+    mCurSample += nLength;
+    mCount -= nPos - mHead;
+    mHead = nPos;
+    *nRun = n;
+    return nClass;
+}
+
+U32 SSDEdgeRing::SkipOnes()
+{
+    U32 nOnes = CountOnes(mHead, GetScanEnd());
+
+    mCurSample += SumIntervals(mHead, mHead + nOnes);
+    mCount -= nOnes;
+    mHead += nOnes;
+    return nOnes;
+}
@@ -0,0 +1,199 @@
+#ifndef SSD_EDGE_READER_H
+#define SSD_EDGE_READER_H
+
+#include "SSDEdgeSource.h"
+#include "SSDHBitKernel.h"
+#include "SSDStats.h"
+
+// Edge reader stage: pulls transitions from an edge source in blocks and keeps
+// them as 32-bit intervals in a fixed-size ring buffer. The decoder reads the
+// edges from here instead of asking the source for every half-bit.
+// Each block is classified in one pass by SSDHBitKernel: the half-bit class
+// of every interval and the bit formed by every pair of intervals are ready
+// before the state machine asks for them.
+// The HBIT_1 classes are also kept as a bitmask, so runs of preamble
+// half-bits are found a 64-bit word at a time.
+// SSDEdgeRing holds everything but the source; SSDEdgeReader<Source> adds the
+// refill, so the accessors below inline into the decoder for each source.
+class SSDEdgeRing
+{
+public:
+    enum { RING_SIZE = 4096 };      // Power of 2
+
+    SSDEdgeRing();
+
+    void SetLimits(const SSDHBitLimits& limits);    // Reclassifies the intervals not consumed yet
+    U64 GetConsumed() const { return mLoaded - mCount; }   // Intervals consumed since Init
+    void SetScanLimit(U64 nConsumed) { mScanLimit = nConsumed; }  // ScanHBitRun stops there (parallel chunks)
+
+    // Intervals consumed and their classes, across Init calls, since ClearCounts
+    void GetCounts(U64* nEdges, U64* classes) const;
+    void AddCounts(const SSDEdgeRing& ring);
+    void ClearCounts();
+
+    // Interval length histogram, kept like the counts above (Timing Report)
+    void SetHistogram(U32 nSampleRateHz) { mHistogram.SetSampleRate(nSampleRateHz); }  // 0: off
+    void GetHistogram(SSDTimingHistogram* histogram) const;
+
+    // Same semantics as AnalyzerChannelData, served from the ring buffer
+    U64 GetSampleNumber() const { return mCurSample; }
+    U8 GetBitOfNextPair() const { return mPair[mHead]; }
+    void AdvancePair()
+    {
+        mCurSample += GetInterval(mHead) + GetInterval(mHead + 1);
+        mHead += 2;
+        mCount -= 2;
+    }
+
+    // The 8 bits of the next 16 intervals, MSB first, if they are all in the
+    // ring and all valid. Otherwise returns false and consumes nothing.
+    bool ReadPairByte(U32* nByte)
+    {
+        if (mCount < 16)
+            return false;
+
+        U32 nBits = 0;
+        U32 nErrors = 0;
+        for (U32 i = 0; i < 16; i += 2) {
+            U32 nBit = mPair[mHead + i];
+            nBits = (nBits << 1) | (nBit & 1);
+            nErrors |= nBit;
+        }
+        if (nErrors > 1)
+            return false;
+
+        // Pas d'INTERVAL_LONG ici: il donne toujours une erreur
+        U64 nLength = 0;
+        for (U32 i = 0; i < 16; i++)
+            nLength += mRing[mHead + i];
+
+        mCurSample += nLength;
+        mHead += 16;
+        mCount -= 16;
+        *nByte = nBits;
+        return true;
+    }
+
+protected:
+    void Restart(U64 nStartSample);
+    void Classify();
+    void ClassifyRange(U32 nFrom, U32 nTo);
+    U8 ScanRun(U32* nRun, U32 nTarget, U64* nRunStart);
+    U32 SkipOnes();
+    U32 GetScanEnd() const;
+    U32 CountOnes(U32 nFrom, U32 nTo) const;
+    U64 SumIntervals(U32 nFrom, U32 nTo) const;
+    void CountClasses(U32 nFrom, U32 nTo, U64* classes) const;
+    U64 GetInterval(U32 nIndex) const
+    {
+        U32 nInterval = mRing[nIndex];
+        return (nInterval == INTERVAL_LONG) ? mLongInterval : nInterval;
+    }
+
+protected: //vars
+    SSDHBitLimits mLimits;
+
+    U32 mRing[RING_SIZE];           // Intervals between consecutive edges
+    U8 mClass[RING_SIZE];           // Half-bit class of each interval
+    U8 mPair[RING_SIZE];            // Bit made of intervals i and i+1
+    U64 mOnes[RING_SIZE / 64];      // Bit i set when mClass[i] == HBIT_1
+    U32 mHead;                      // Next interval to consume
+    U32 mCount;                     // Intervals available
+    U64 mCurSample;                 // Sample of the last consumed edge
+    U64 mLongInterval;              // Interval stored behind an INTERVAL_LONG entry
+    U64 mLoaded;                    // Intervals put in the ring since Init
+    U64 mScanLimit;                 // GetConsumed() value ScanHBitRun does not go past
+    U64 mEdgeCount;                 // Intervals consumed before the last Restart
+    U64 mClassCount[4];             // Classes of the intervals loaded, less the ones never consumed
+    SSDTimingHistogram mHistogram;  // Same, for the lengths
+};
+
+template <class Source>
+class SSDEdgeReader : public SSDEdgeRing
+{
+public:
+    // The source starts right after the edge at nStartSample
+    void Init(const Source& source, U64 nStartSample)
+    {
+        mSource = source;
+        Restart(nStartSample);
+    }
+
+    Source& GetSource() { return mSource; }
+    const Source& GetSource() const { return mSource; }
+
+    // The next read would block waiting for data.
+    // Un bit lit au plus deux demi-bits et un troisieme en lookahead.
+    bool IsWaitingForData() const { return mCount < 3 && mSource.IsWaitingForData(); }
+
+    U64 GetSampleOfNextEdge()
+    {
+        if (mCount == 0)
+            Fill();
+
+        return mCurSample + GetInterval(mHead);
+    }
+
+    void AdvanceToNextEdge()
+    {
+        if (mCount == 0)
+            Fill();
+
+        mCurSample += GetInterval(mHead);
+        mHead = (mHead + 1) & (RING_SIZE - 1);
+        mCount--;
+    }
+
+    // Precomputed classification of the next interval(s)
+    U8 GetClassOfNextEdge()
+    {
+        if (mCount == 0)
+            Fill();
+
+        return mClass[mHead];
+    }
+
+    bool IsNextPairReady()          // Both half-bits of the next bit are in the ring
+    {
+        if (mCount == 0)
+            Fill();
+
+        return mCount >= 2;
+    }
+
+    // Consumes half-bits until *nRun consecutive HBIT_1 reach nTarget, or the
+    // ring or the scan limit is reached. Any other class (gap, error, 0)
+    // restarts the run, *nRunStart then gets the sample after its edge.
+    // Returns the class of the last half-bit consumed, HBIT_SPLIT if none.
+    U8 ScanHBitRun(U32* nRun, U32 nTarget, U64* nRunStart)
+    {
+        if (mCount == 0)
+            Fill();
+
+        return ScanRun(nRun, nTarget, nRunStart);
+    }
+
+    // Consumes the HBIT_1 half-bits in front of the ring, not the one after
+    // them. Returns how many.
+    U32 SkipHBitOnes()
+    {
+        if (mCount == 0)
+            Fill();
+
+        return SkipOnes();
+    }
+
+protected:
+    void Fill()
+    {
+        // Only called when the ring is empty. Restarting at 0 keeps the
+        // block contiguous for the kernels.
+        mHead = 0;
+        mCount = mSource.Fetch(mRing, RING_SIZE, &mLongInterval);
+        Classify();
+    }
+
+    Source mSource;
+};
+
+#endif //SSD_EDGE_READER_H
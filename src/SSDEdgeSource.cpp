@@ -0,0 +1,106 @@
+#include "SSDEdgeSource.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SSDMappedFile::SSDMappedFile()
+    : mData(NULL),
+    mSize(0),
+    mBeginTime(0.0),
+    mTransitions(0)
+#ifdef _WIN32
+    , mFile(INVALID_HANDLE_VALUE),
+    mMapping(NULL)
+#endif
+{
+}
+
+SSDMappedFile::~SSDMappedFile()
+{
+    Close();
+}
+
+bool SSDMappedFile::Open(const char* path)
+{
+    Close();
+
+#ifdef _WIN32
+    mFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size) || size.QuadPart < HEADER_SIZE) {
+        Close();
+        return false;
+    }
+    mSize = (U64)size.QuadPart;
+
+    mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping != NULL)
+        mData = (const U8*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (mData == NULL) {
+        Close();
+        return false;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+        close(fd);
+        return false;
+    }
+    mSize = (U64)st.st_size;
+
+    void* data = mmap(NULL, (size_t)mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    madvise(data, (size_t)mSize, MADV_SEQUENTIAL);
+    mData = (const U8*)data;
+#endif
+
+    // Entete: identifiant, version, type (0 = digital), etat initial, debut, fin, nombre de transitions
+    S32 nType;
+    memcpy(&nType, mData + 12, sizeof(nType));
+    memcpy(&mBeginTime, mData + 20, sizeof(mBeginTime));
+    memcpy(&mTransitions, mData + 36, sizeof(mTransitions));
+
+    if (memcmp(mData, "<SALEAE>", 8) != 0 || nType != 0 ||
+        mTransitions > (mSize - HEADER_SIZE) / sizeof(double)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SSDMappedFile::Close()
+{
+#ifdef _WIN32
+    if (mData != NULL)
+        UnmapViewOfFile(mData);
+    if (mMapping != NULL)
+        CloseHandle(mMapping);
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+    mMapping = NULL;
+    mFile = INVALID_HANDLE_VALUE;
+#else
+    if (mData != NULL)
+        munmap((void*)mData, (size_t)mSize);
+#endif
+
+    mData = NULL;
+    mSize = 0;
+    mBeginTime = 0.0;
+    mTransitions = 0;
+}
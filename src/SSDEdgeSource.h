@@ -0,0 +1,277 @@
+#ifndef SSD_EDGE_SOURCE_H
+#define SSD_EDGE_SOURCE_H
+
+#include <exception>
+#include <string.h>
+#include "SSDProtocol.h"
+
+// Marker stored in the ring when the interval does not fit in 32 bits
+// (long idle periods at high sample rates). The real value is kept in
+// mLongInterval and the block is closed right after it, so there is never
+// more than one pending.
+#define INTERVAL_LONG 0xFFFFFFFF
+
+// Thrown when a source has no edge left (memory and file sources)
+class SSDEndOfData : public std::exception
+{
+public:
+    virtual const char* what() const throw() { return "SSD: end of edge data"; }
+};
+
+// Edge sources feed SSDEdgeReader<Source> with intervals between edges.
+// A source is copied with the reader (parallel decoding), so it only holds
+// a position in data owned by someone else. It provides:
+//
+//   U32 Fetch(U32* intervals, U32 nMax, U64* nLong)
+//       Copies between 1 and nMax intervals, waiting for the first one if
+//       needed. An INTERVAL_LONG entry ends the block and its value goes to
+//       *nLong. Throws SSDEndOfData when there is no edge left.
+//   bool IsWaitingForData() const
+//       The next Fetch would block waiting for new data.
+//
+// SSDChannelSource (SSDChannelSource.h) reads the Logic 2 channel; the two
+// below have no SDK dependency.
+
+// Deglitch filter, applied where the edges are first read (channel, file):
+// a pulse shorter than the threshold is merged with the intervals on both
+// sides, so a spike inside a half-bit leaves one interval instead of three.
+// Each interval is held until the next one shows it is not followed by a
+// glitch. Copied with the source that owns it, no allocation.
+class SSDDeglitch
+{
+public:
+    SSDDeglitch()
+        : mThreshold(0),
+        mPending(0),
+        mHasPending(false),
+        mMerging(false)
+    {
+    }
+
+    // nThresholdNs == 0: no filtering
+    SSDDeglitch(U32 nThresholdNs, U32 nSampleRateHz)
+        : mThreshold(((U64)nThresholdNs * nSampleRateHz + 500000000) / 1000000000),
+        mPending(0),
+        mHasPending(false),
+        mMerging(false)
+    {
+    }
+
+    // Takes the next interval. Returns true when *nOut holds a finished one.
+    bool Push(U64 nInterval, U64* nOut)
+    {
+        if (mThreshold == 0) {
+            *nOut = nInterval;
+            return true;
+        }
+
+        // Apres une impulsion courte, l'intervalle suivant la rejoint aussi
+        if (mMerging) {
+            mPending += nInterval;
+            mMerging = false;
+            return false;
+        }
+        if (nInterval < mThreshold && mHasPending) {
+            mPending += nInterval;
+            mMerging = true;
+            return false;
+        }
+
+        bool bOut = mHasPending;
+        *nOut = mPending;
+        mPending = nInterval;
+        mHasPending = true;
+        return bOut;
+    }
+
+    // End of the edges: the interval held back, if any
+    bool Flush(U64* nOut)
+    {
+        bool bOut = mHasPending;
+        *nOut = mPending;
+        mPending = 0;
+        mHasPending = false;
+        mMerging = false;
+        return bOut;
+    }
+
+protected:
+    U64 mThreshold;                 // Samples
+    U64 mPending;
+    bool mHasPending;
+    bool mMerging;                  // mPending still takes the next interval
+};
+
+// Intervals already in memory
+class SSDMemorySource
+{
+public:
+    SSDMemorySource()
+        : mIntervals(NULL),
+        mLeft(0),
+        mLongs(NULL)
+    {
+    }
+
+    // The INTERVAL_LONG entries of intervals stand for the values of longs, in order
+    SSDMemorySource(const U32* intervals, U64 count, const U64* longs)
+        : mIntervals(intervals),
+        mLeft(count),
+        mLongs(longs)
+    {
+    }
+
+    U32 Fetch(U32* intervals, U32 nMax, U64* nLong)
+    {
+        if (mLeft == 0)
+            throw SSDEndOfData();
+
+        U32 nCount = (mLeft < nMax) ? (U32)mLeft : nMax;
+
+        // Comme pour le canal, un INTERVAL_LONG ferme le bloc
+        for (U32 i = 0; i < nCount; i++) {
+            if (mIntervals[i] == INTERVAL_LONG) {
+                nCount = i + 1;
+                *nLong = *mLongs++;
+                break;
+            }
+        }
+
+        memcpy(intervals, mIntervals, nCount * sizeof(U32));
+        mIntervals += nCount;
+        mLeft -= nCount;
+        return nCount;
+    }
+
+    bool IsWaitingForData() const { return false; }
+    bool IsEmpty() const { return mLeft == 0; }
+
+protected:
+    const U32* mIntervals;
+    U64 mLeft;
+    const U64* mLongs;
+};
+
+// Logic 2 binary export of one digital channel ("<SALEAE>" header, then the
+// transition times as doubles), mapped read-only
+class SSDMappedFile
+{
+public:
+    SSDMappedFile();
+    ~SSDMappedFile();
+
+    bool Open(const char* path);    // false if missing or not a digital export
+    void Close();
+
+    double GetBeginTime() const { return mBeginTime; }
+    U64 GetTransitionCount() const { return mTransitions; }
+    const U8* GetTransitionData() const { return mData + HEADER_SIZE; }   // Unaligned doubles
+
+protected:
+    enum { HEADER_SIZE = 44 };
+
+    const U8* mData;
+    U64 mSize;
+    double mBeginTime;
+    U64 mTransitions;
+#ifdef _WIN32
+    void* mFile;
+    void* mMapping;
+#endif
+
+private:
+    SSDMappedFile(const SSDMappedFile&);
+    SSDMappedFile& operator=(const SSDMappedFile&);
+};
+
+// Transitions of an SSDMappedFile, converted to intervals at a given sample rate
+class SSDMappedFileSource
+{
+public:
+    SSDMappedFileSource()
+        : mTimes(NULL),
+        mLeft(0),
+        mBeginTime(0.0),
+        mSampleRate(0.0),
+        mLastSample(0)
+    {
+    }
+
+    SSDMappedFileSource(const SSDMappedFile& file, U32 nSampleRateHz, const SSDDeglitch& deglitch = SSDDeglitch())
+        : mTimes(file.GetTransitionData()),
+        mLeft(file.GetTransitionCount()),
+        mBeginTime(file.GetBeginTime()),
+        mSampleRate(nSampleRateHz),
+        mLastSample(0),
+        mDeglitch(deglitch)
+    {
+    }
+
+    U32 Fetch(U32* intervals, U32 nMax, U64* nLong)
+    {
+        U32 nCount = 0;
+        U64 nInterval;
+
+        // Le filtre peut tout retenir: on continue jusqu'a un intervalle
+        while (nCount == 0) {
+            if (mLeft == 0) {
+                if (!mDeglitch.Flush(&nInterval))
+                    throw SSDEndOfData();
+                nCount = Store(intervals, 0, nInterval, nLong);
+                break;
+            }
+
+            U32 nRead = (mLeft < nMax) ? (U32)mLeft : nMax;
+            U32 i = 0;
+            while (i < nRead) {
+                double dTime;
+                memcpy(&dTime, mTimes, sizeof(dTime));
+                mTimes += sizeof(dTime);
+                i++;
+
+                U64 nSample = SampleOf(dTime);
+                U64 nRaw = nSample - mLastSample;
+                mLastSample = nSample;
+
+                if (mDeglitch.Push(nRaw, &nInterval)) {
+                    nCount = Store(intervals, nCount, nInterval, nLong);
+                    if (intervals[nCount - 1] == INTERVAL_LONG)
+                        break;
+                }
+            }
+            mLeft -= i;
+        }
+        return nCount;
+    }
+
+    bool IsWaitingForData() const { return false; }
+
+protected:
+    static U32 Store(U32* intervals, U32 nCount, U64 nInterval, U64* nLong)
+    {
+        if (nInterval >= INTERVAL_LONG) {
+            *nLong = nInterval;
+            intervals[nCount] = INTERVAL_LONG;
+        }
+        else {
+            intervals[nCount] = (U32)nInterval;
+        }
+        return nCount + 1;
+    }
+
+    U64 SampleOf(double dTime) const
+    {
+        // Sample 0 is the start of the capture; the times never go back
+        double dSample = (dTime - mBeginTime) * mSampleRate + 0.5;
+        return (dSample <= (double)mLastSample) ? mLastSample : (U64)dSample;
+    }
+
+    const U8* mTimes;
+    U64 mLeft;
+    double mBeginTime;
+    double mSampleRate;
+    U64 mLastSample;
+    SSDDeglitch mDeglitch;
+};
+
+#endif //SSD_EDGE_SOURCE_H
@@ -0,0 +1,130 @@
+#include "SSDExportWriter.h"
+
+#define TIME_DECIMALS   15          // Comme GetTimeString: 9 chiffres puis 6
+
+SSDExportWriter::SSDExportWriter(WriteFn write, void* context)
+    : mWrite(write),
+    mContext(context),
+    mBuffer(new char[BUFFER_SIZE]),
+    mLength(0)
+{
+}
+
+SSDExportWriter::~SSDExportWriter()
+{
+    Flush();
+    delete[] mBuffer;
+}
+
+void SSDExportWriter::Flush()
+{
+    if (mLength != 0)
+        mWrite(mContext, mBuffer, mLength);
+    mLength = 0;
+}
+
+void SSDExportWriter::Bytes(const void* data, U32 nLength)
+{
+    // Plus grand que le tampon: ecrit directement
+    if (nLength > BUFFER_SIZE) {
+        Flush();
+        mWrite(mContext, (const char*)data, nLength);
+        return;
+    }
+    memcpy(Reserve(nLength), data, nLength);
+    mLength += nLength;
+}
+
+// Chiffres de nValue a la fin de buffer, nDigits au moins. Retourne le premier.
+static char* FormatDecimal(char* end, U64 nValue, U32 nDigits)
+{
+    char* p = end;
+    do {
+        *--p = (char)('0' + nValue % 10);
+        nValue /= 10;
+    } while (nValue != 0);
+    while ((U32)(end - p) < nDigits)
+        *--p = '0';
+    return p;
+}
+
+void SSDExportWriter::Decimal(U64 nValue)
+{
+    char buffer[20];
+    char* p = FormatDecimal(buffer + sizeof(buffer), nValue, 1);
+    Text(p, (U32)(buffer + sizeof(buffer) - p));
+}
+
+void SSDExportWriter::Hex(U64 nValue, U32 nDigits)
+{
+    static const char sDigits[] = "0123456789ABCDEF";
+    char buffer[18];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+    do {
+        *--p = sDigits[nValue & 15];
+        nValue >>= 4;
+    } while (nValue != 0);
+    while ((U32)(end - p) < nDigits && p > buffer + 2)
+        *--p = '0';
+    *--p = 'x';
+    *--p = '0';
+    Text(p, (U32)(end - p));
+}
+
+void SSDExportWriter::Fixed(U64 nValue, U32 nDivisor, U32 nDecimals)
+{
+    static const U64 sPowers[10] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+    U64 nScale = sPowers[(nDecimals < 9) ? nDecimals : 9];
+    U64 nInteger = nValue / nDivisor;
+    U64 nRemainder = nValue % nDivisor;
+
+    // Reste < 2^32, echelle <= 10^9: pas de debordement
+    U64 nFraction = nRemainder * nScale / nDivisor;
+    if ((nRemainder * nScale % nDivisor) * 2 >= nDivisor && ++nFraction == nScale) {
+        nFraction = 0;
+        nInteger++;
+    }
+
+    char buffer[32];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+    if (nScale > 1) {
+        p = FormatDecimal(p, nFraction, (nDecimals < 9) ? nDecimals : 9);
+        *--p = '.';
+    }
+    p = FormatDecimal(p, nInteger, 1);
+    Text(p, (U32)(end - p));
+}
+
+void SSDExportWriter::Time(U64 nSample, U64 nTriggerSample, U32 nSampleRateHz)
+{
+    bool bNegative = (nSample < nTriggerSample);
+    U64 nDelta = bNegative ? nTriggerSample - nSample : nSample - nTriggerSample;
+    U64 nSeconds = nDelta / nSampleRateHz;
+    U64 nRemainder = nDelta % nSampleRateHz;
+
+    // Division exacte, en deux fois pour rester sur 64 bits (reste < 2^32),
+    // arrondie au 15e chiffre
+    U64 nHigh = nRemainder * 1000000000 / nSampleRateHz;
+    nRemainder = nRemainder * 1000000000 % nSampleRateHz;
+    U64 nLow = nRemainder * 1000000 / nSampleRateHz;
+    nRemainder = nRemainder * 1000000 % nSampleRateHz;
+    if (nRemainder * 2 >= nSampleRateHz && ++nLow == 1000000) {
+        nLow = 0;
+        if (++nHigh == 1000000000) {
+            nHigh = 0;
+            nSeconds++;
+        }
+    }
+
+    char buffer[40];
+    char* end = buffer + sizeof(buffer);
+    char* p = FormatDecimal(end, nLow, TIME_DECIMALS - 9);
+    p = FormatDecimal(p, nHigh, 9);
+    *--p = '.';
+    p = FormatDecimal(p, nSeconds, 1);
+    if (bNegative)
+        *--p = '-';
+    Text(p, (U32)(end - p));
+}
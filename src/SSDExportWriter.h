@@ -0,0 +1,51 @@
+#ifndef SSD_EXPORT_WRITER_H
+#define SSD_EXPORT_WRITER_H
+
+#include <string.h>
+#include "SSDProtocol.h"
+
+// Output buffer of the export files. Rows are formatted straight into one
+// fixed buffer (integers, hex and times by hand, no stream and no per-row
+// allocation) and handed to the file in BUFFER_SIZE writes. No SDK
+// dependency: the plugin passes AnalyzerHelpers::AppendToFile as WriteFn.
+class SSDExportWriter
+{
+public:
+    enum { BUFFER_SIZE = 4 << 20 };
+    typedef void (*WriteFn)(void* context, const char* data, U32 nLength);
+
+    SSDExportWriter(WriteFn write, void* context);
+    ~SSDExportWriter();             // Flushes
+
+    void Flush();
+
+    // Room for nLength characters, written then committed with Advance()
+    char* Reserve(U32 nLength)
+    {
+        if (mLength + nLength > BUFFER_SIZE)
+            Flush();
+        return mBuffer + mLength;
+    }
+    void Advance(U32 nLength) { mLength += nLength; }
+
+    void Char(char c) { *Reserve(1) = c; mLength++; }
+    void Text(const char* text) { Text(text, (U32)strlen(text)); }
+    void Text(const char* text, U32 nLength) { Bytes(text, nLength); }
+    void Bytes(const void* data, U32 nLength);
+    void Decimal(U64 nValue);
+    void Hex(U64 nValue, U32 nDigits);          // "0x", upper case, zero-padded to nDigits
+    void Fixed(U64 nValue, U32 nDivisor, U32 nDecimals);    // nValue / nDivisor rounded to nDecimals (9 at most)
+    void Time(U64 nSample, U64 nTriggerSample, U32 nSampleRateHz);   // Seconds, same text as AnalyzerHelpers::GetTimeString
+
+protected:
+    WriteFn mWrite;
+    void* mContext;
+    char* mBuffer;
+    U32 mLength;
+
+private:
+    SSDExportWriter(const SSDExportWriter&);
+    SSDExportWriter& operator=(const SSDExportWriter&);
+};
+
+#endif //SSD_EXPORT_WRITER_H
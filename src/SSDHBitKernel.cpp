@@ -0,0 +1,283 @@
+#include "SSDHBitKernel.h"
+#include "SSDDecoder.h"
+#include <string.h>
+
+#ifdef SSD_KERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SSD_TARGET(isa)
+#else
+#define SSD_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar reference
+
+U8 SSDHBitKernel::ClassifyOne(const SSDHBitLimits& limits, U32 nInterval)
+{
+    if (nInterval >= limits.mMin1hbit && nInterval <= limits.mMax1hbit)
+        return HBIT_1;
+    else if (nInterval >= limits.mMin0hbit && nInterval <= limits.mMax0hbit)
+        return HBIT_0;
+    else if (nInterval >= limits.mMinPEHold && nInterval <= limits.mMaxPGap)
+        return HBIT_GAP;
+    else
+        return HBIT_ERR;
+}
+
+U8 SSDHBitKernel::PairOne(const SSDHBitLimits& limits, U8 nClass1, U8 nClass2, U32 nBitLen)
+{
+    // Meme logique que GetNextBit: un gap au milieu d'un bit est une erreur
+    if ((nClass1 > 1) || (nClass2 > 1) || (nBitLen > limits.mMaxBitLen))
+        return BIT_ERROR_FLAG;
+    else if (nClass1 != nClass2)
+        return FRAMING_ERROR_FLAG;
+    else
+        return nClass1;
+}
+
+void SSDHBitKernel::ClassifyScalar(const SSDHBitLimits& limits, const U32* intervals, U8* classes, U32 count)
+{
+    for (U32 i = 0; i < count; i++)
+        classes[i] = ClassifyOne(limits, intervals[i]);
+}
+
+void SSDHBitKernel::PairScalar(const SSDHBitLimits& limits, const U32* intervals, const U8* classes, U8* bits, U32 count)
+{
+    for (U32 i = 0; i + 1 < count; i++)
+        bits[i] = PairOne(limits, classes[i], classes[i + 1], intervals[i] + intervals[i + 1]);
+}
+
+#ifdef SSD_KERNEL_X86
+
+// ---------------------------------------------------------------------------
+// SSE4.1: 4 intervals per vector, 8 per iteration
+
+SSD_TARGET("sse4.1")
+static inline __m128i InRange128(__m128i x, __m128i lo, __m128i hi)
+{
+    __m128i ge = _mm_cmpeq_epi32(_mm_max_epu32(x, lo), x);
+    __m128i le = _mm_cmpeq_epi32(_mm_min_epu32(x, hi), x);
+    return _mm_and_si128(ge, le);
+}
+
+SSD_TARGET("sse4.1")
+static inline __m128i Classify128(__m128i x, const SSDHBitLimits& limits)
+{
+    // Priorite inverse: erreur < gap < 0 < 1
+    __m128i c = _mm_set1_epi32(HBIT_ERR);
+    c = _mm_blendv_epi8(c, _mm_set1_epi32(HBIT_GAP),
+        InRange128(x, _mm_set1_epi32((int)limits.mMinPEHold), _mm_set1_epi32((int)limits.mMaxPGap)));
+    c = _mm_blendv_epi8(c, _mm_set1_epi32(HBIT_0),
+        InRange128(x, _mm_set1_epi32((int)limits.mMin0hbit), _mm_set1_epi32((int)limits.mMax0hbit)));
+    c = _mm_blendv_epi8(c, _mm_set1_epi32(HBIT_1),
+        InRange128(x, _mm_set1_epi32((int)limits.mMin1hbit), _mm_set1_epi32((int)limits.mMax1hbit)));
+    return c;
+}
+
+SSD_TARGET("sse4.1")
+static inline __m128i LoadClasses128(const U8* p)
+{
+    int n;
+    memcpy(&n, p, sizeof(n));
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(n));
+}
+
+SSD_TARGET("sse4.1")
+static inline __m128i Pair128(__m128i c1, __m128i c2, __m128i len, const SSDHBitLimits& limits)
+{
+    __m128i one = _mm_set1_epi32(1);
+    __m128i bad = _mm_or_si128(_mm_cmpgt_epi32(c1, one), _mm_cmpgt_epi32(c2, one));
+    __m128i maxlen = _mm_set1_epi32((int)limits.mMaxBitLen);
+    bad = _mm_or_si128(bad, _mm_xor_si128(_mm_cmpeq_epi32(_mm_min_epu32(len, maxlen), len), _mm_set1_epi32(-1)));
+    __m128i diff = _mm_xor_si128(_mm_cmpeq_epi32(c1, c2), _mm_set1_epi32(-1));
+
+    __m128i b = _mm_blendv_epi8(c1, _mm_set1_epi32(FRAMING_ERROR_FLAG), diff);
+    return _mm_blendv_epi8(b, _mm_set1_epi32(BIT_ERROR_FLAG), bad);
+}
+
+SSD_TARGET("sse4.1")
+static inline void Store8(U8* p, __m128i lo, __m128i hi)
+{
+    __m128i w = _mm_packus_epi32(lo, hi);
+    _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(w, w));
+}
+
+SSD_TARGET("sse4.1")
+void SSDHBitKernel::ClassifySSE41(const SSDHBitLimits& limits, const U32* intervals, U8* classes, U32 count)
+{
+    U32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = Classify128(_mm_loadu_si128((const __m128i*)(intervals + i)), limits);
+        __m128i hi = Classify128(_mm_loadu_si128((const __m128i*)(intervals + i + 4)), limits);
+        Store8(classes + i, lo, hi);
+    }
+    ClassifyScalar(limits, intervals + i, classes + i, count - i);
+}
+
+SSD_TARGET("sse4.1")
+void SSDHBitKernel::PairSSE41(const SSDHBitLimits& limits, const U32* intervals, const U8* classes, U8* bits, U32 count)
+{
+    U32 i = 0;
+    for (; i + 9 <= count; i += 8) {
+        __m128i len_lo = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(intervals + i)),
+                                       _mm_loadu_si128((const __m128i*)(intervals + i + 1)));
+        __m128i len_hi = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(intervals + i + 4)),
+                                       _mm_loadu_si128((const __m128i*)(intervals + i + 5)));
+        __m128i lo = Pair128(LoadClasses128(classes + i), LoadClasses128(classes + i + 1), len_lo, limits);
+        __m128i hi = Pair128(LoadClasses128(classes + i + 4), LoadClasses128(classes + i + 5), len_hi, limits);
+        Store8(bits + i, lo, hi);
+    }
+    if (count > i)
+        PairScalar(limits, intervals + i, classes + i, bits + i, count - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: 8 intervals per iteration
+
+SSD_TARGET("avx2")
+static inline __m256i InRange256(__m256i x, __m256i lo, __m256i hi)
+{
+    __m256i ge = _mm256_cmpeq_epi32(_mm256_max_epu32(x, lo), x);
+    __m256i le = _mm256_cmpeq_epi32(_mm256_min_epu32(x, hi), x);
+    return _mm256_and_si256(ge, le);
+}
+
+SSD_TARGET("avx2")
+static inline void Store8(U8* p, __m256i v)
+{
+    __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(w, w));
+}
+
+SSD_TARGET("avx2")
+void SSDHBitKernel::ClassifyAVX2(const SSDHBitLimits& limits, const U32* intervals, U8* classes, U32 count)
+{
+    __m256i min1 = _mm256_set1_epi32((int)limits.mMin1hbit), max1 = _mm256_set1_epi32((int)limits.mMax1hbit);
+    __m256i min0 = _mm256_set1_epi32((int)limits.mMin0hbit), max0 = _mm256_set1_epi32((int)limits.mMax0hbit);
+    __m256i ming = _mm256_set1_epi32((int)limits.mMinPEHold), maxg = _mm256_set1_epi32((int)limits.mMaxPGap);
+
+    U32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(intervals + i));
+        __m256i c = _mm256_set1_epi32(HBIT_ERR);
+        c = _mm256_blendv_epi8(c, _mm256_set1_epi32(HBIT_GAP), InRange256(x, ming, maxg));
+        c = _mm256_blendv_epi8(c, _mm256_set1_epi32(HBIT_0), InRange256(x, min0, max0));
+        c = _mm256_blendv_epi8(c, _mm256_set1_epi32(HBIT_1), InRange256(x, min1, max1));
+        Store8(classes + i, c);
+    }
+    ClassifyScalar(limits, intervals + i, classes + i, count - i);
+}
+
+SSD_TARGET("avx2")
+void SSDHBitKernel::PairAVX2(const SSDHBitLimits& limits, const U32* intervals, const U8* classes, U8* bits, U32 count)
+{
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i all = _mm256_set1_epi32(-1);
+    __m256i maxlen = _mm256_set1_epi32((int)limits.mMaxBitLen);
+
+    U32 i = 0;
+    for (; i + 9 <= count; i += 8) {
+        __m256i len = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(intervals + i)),
+                                       _mm256_loadu_si256((const __m256i*)(intervals + i + 1)));
+        __m256i c1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(classes + i)));
+        __m256i c2 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(classes + i + 1)));
+
+        __m256i bad = _mm256_or_si256(_mm256_cmpgt_epi32(c1, one), _mm256_cmpgt_epi32(c2, one));
+        bad = _mm256_or_si256(bad, _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_min_epu32(len, maxlen), len), all));
+        __m256i diff = _mm256_xor_si256(_mm256_cmpeq_epi32(c1, c2), all);
+
+        __m256i b = _mm256_blendv_epi8(c1, _mm256_set1_epi32(FRAMING_ERROR_FLAG), diff);
+        b = _mm256_blendv_epi8(b, _mm256_set1_epi32(BIT_ERROR_FLAG), bad);
+        Store8(bits + i, b);
+    }
+    if (count > i)
+        PairScalar(limits, intervals + i, classes + i, bits + i, count - i);
+}
+
+// ---------------------------------------------------------------------------
+// Runtime dispatch
+
+bool SSDHBitKernel::HasSSE41()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1") != 0;
+#endif
+}
+
+bool SSDHBitKernel::HasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+static SSDHBitKernel::ClassifyFn PickClassify()
+{
+    if (SSDHBitKernel::HasAVX2())
+        return SSDHBitKernel::ClassifyAVX2;
+    if (SSDHBitKernel::HasSSE41())
+        return SSDHBitKernel::ClassifySSE41;
+    return SSDHBitKernel::ClassifyScalar;
+}
+
+static SSDHBitKernel::PairFn PickPair()
+{
+    if (SSDHBitKernel::HasAVX2())
+        return SSDHBitKernel::PairAVX2;
+    if (SSDHBitKernel::HasSSE41())
+        return SSDHBitKernel::PairSSE41;
+    return SSDHBitKernel::PairScalar;
+}
+
+static const char* PickName()
+{
+    if (SSDHBitKernel::HasAVX2())
+        return "AVX2";
+    if (SSDHBitKernel::HasSSE41())
+        return "SSE4.1";
+    return "scalar";
+}
+
+#else
+
+static SSDHBitKernel::ClassifyFn PickClassify() { return SSDHBitKernel::ClassifyScalar; }
+static SSDHBitKernel::PairFn PickPair() { return SSDHBitKernel::PairScalar; }
+static const char* PickName() { return "scalar"; }
+
+#endif
+
+SSDHBitKernel::ClassifyFn SSDHBitKernel::sClassify = PickClassify();
+SSDHBitKernel::PairFn SSDHBitKernel::sPair = PickPair();
+const char* SSDHBitKernel::sName = PickName();
+
+void SSDHBitKernel::Classify(const SSDHBitLimits& limits, const U32* intervals, U8* classes, U32 count)
+{
+    sClassify(limits, intervals, classes, count);
+}
+
+void SSDHBitKernel::Pair(const SSDHBitLimits& limits, const U32* intervals, const U8* classes, U8* bits, U32 count)
+{
+    sPair(limits, intervals, classes, bits, count);
+}
+
+const char* SSDHBitKernel::GetName()
+{
+    return sName;
+}
@@ -0,0 +1,64 @@
+#ifndef SSD_HBIT_KERNEL_H
+#define SSD_HBIT_KERNEL_H
+
+#include "SSDProtocol.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SSD_KERNEL_X86
+#endif
+
+// Half-bit classes (values returned by SSDDecoder::GetNextHBit / LookaheadNextHBit)
+#define HBIT_0      0
+#define HBIT_1      1
+#define HBIT_ERR    BIT_ERROR_FLAG
+#define HBIT_GAP    3
+#define HBIT_SPLIT  0xFF            // Table bucket straddling a limit: compare exactly
+
+// Timing windows in samples, as computed by SSDAnalyzer::Setup()
+struct SSDHBitLimits
+{
+    U32 mMin1hbit, mMax1hbit;
+    U32 mMin0hbit, mMax0hbit;
+    U32 mMinPEHold, mMaxPGap;
+    U32 mMaxBitLen;
+};
+
+// Batch half-bit classification over arrays of edge intervals.
+// Classify: classes[i] = HBIT_1 / HBIT_0 / HBIT_GAP / HBIT_ERR for intervals[i]
+//           (same result as SSDDecoder::LookaheadNextHBit).
+// Pair:     bits[i] = value of the bit made of half-bits i and i+1, or
+//           BIT_ERROR_FLAG / FRAMING_ERROR_FLAG (same result as GetNextBit).
+//           Writes count - 1 entries.
+// The SSE4.1 and AVX2 versions return exactly what the scalar ones do; the
+// best one available is picked at runtime.
+class SSDHBitKernel
+{
+public:
+    typedef void (*ClassifyFn)(const SSDHBitLimits& limits, const U32* intervals, U8* classes, U32 count);
+    typedef void (*PairFn)(const SSDHBitLimits& limits, const U32* intervals, const U8* classes, U8* bits, U32 count);
+
+    static void Classify(const SSDHBitLimits& limits, const U32* intervals, U8* classes, U32 count);
+    static void Pair(const SSDHBitLimits& limits, const U32* intervals, const U8* classes, U8* bits, U32 count);
+    static const char* GetName();
+
+    static U8 ClassifyOne(const SSDHBitLimits& limits, U32 nInterval);
+    static U8 PairOne(const SSDHBitLimits& limits, U8 nClass1, U8 nClass2, U32 nBitLen);
+
+    static void ClassifyScalar(const SSDHBitLimits& limits, const U32* intervals, U8* classes, U32 count);
+    static void PairScalar(const SSDHBitLimits& limits, const U32* intervals, const U8* classes, U8* bits, U32 count);
+#ifdef SSD_KERNEL_X86
+    static void ClassifySSE41(const SSDHBitLimits& limits, const U32* intervals, U8* classes, U32 count);
+    static void PairSSE41(const SSDHBitLimits& limits, const U32* intervals, const U8* classes, U8* bits, U32 count);
+    static void ClassifyAVX2(const SSDHBitLimits& limits, const U32* intervals, U8* classes, U32 count);
+    static void PairAVX2(const SSDHBitLimits& limits, const U32* intervals, const U8* classes, U8* bits, U32 count);
+    static bool HasSSE41();         // CPU support of each version (ssd-selftest runs all of them)
+    static bool HasAVX2();
+#endif
+
+protected:
+    static ClassifyFn sClassify;
+    static PairFn sPair;
+    static const char* sName;
+};
+
+#endif //SSD_HBIT_KERNEL_H
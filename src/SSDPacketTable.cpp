@@ -0,0 +1,193 @@
+#include "SSDPacketTable.h"
+#include <string.h>
+
+SSDPacketTable::SSDPacketTable()
+    : mRows(0),
+    mCommitted(0),
+    mOpen(false),
+    mPacketFrame(0)
+{
+    memset(&mPacket, 0, sizeof(mPacket));
+    for (int i = 0; i < 256; i++)
+        mLastValid[i] = false;
+}
+
+SSDPacketTable::~SSDPacketTable()
+{
+    for (size_t i = 0; i < mBlocks.size(); i++)
+        delete mBlocks[i];
+}
+
+void SSDPacketTable::AddFrame(U64 nFrame, eFrameType ft, U8 Flags, U64 nStartSample, U64 nEndSample, U64 Data1, U64 Data2)
+{
+    SSDPacketRecord packet;
+
+    switch (ft) {
+    case FRAME_PREAMBLE:
+        mOpen = true;
+        mPacket.mStart = nStartSample;
+        mPacket.mData = 0;
+        mPacket.mInfo = Data1 & 0xFF;
+        mPacketFrame = nFrame;
+        return;
+    case FRAME_CMDBYTE:
+        mPacket.mData = Data1 & 0xFF;
+        return;
+    case FRAME_CARDATA:
+        if (Data2 >= 1 && Data2 <= 6) {
+            mPacket.mData |= (Data1 & 0xFF) << (8 * Data2);
+            mPacket.mInfo = (mPacket.mInfo & 0xFFFF) | (Data2 << 16);
+        }
+        return;
+    case FRAME_CHECKSUM:
+        if (!mOpen)
+            return;
+        mOpen = false;
+        packet = mPacket;
+        packet.mEnd = nEndSample;
+        packet.mData |= (Data1 & 0xFF) << (8 * PACKET_CHECKSUM_INDEX);
+        packet.mInfo |= (Data2 & 0xFF) << 8;
+        packet.mFlags = Flags;
+        packet.mRepeat = 1;
+        Append(packet, mPacketFrame, nFrame);
+        break;
+    case FRAME_PACKET:
+        mOpen = false;
+        packet.mStart = nStartSample;
+        packet.mEnd = nEndSample;
+        packet.mData = Data1;
+        packet.mInfo = Data2;
+        packet.mFlags = Flags;
+        packet.mRepeat = 1;
+        Append(packet, nFrame, nFrame);
+        break;
+    case FRAME_REPEAT:
+        if (!mLastValid[(U8)Data2])
+            return;
+        packet = mLast[(U8)Data2];
+        packet.mStart = nStartSample;
+        packet.mEnd = nEndSample;
+        packet.mFlags = 0;
+        packet.mRepeat = Data1;
+        Append(packet, nFrame, nFrame);
+        return;
+    case FRAME_PSBIT:
+    case FRAME_DSBIT:
+    case FRAME_PEBIT:
+        return;
+    default:
+        mOpen = false;
+        return;
+    }
+
+    if ((packet.mFlags & CHECKSUM_ERROR_FLAG) == 0) {
+        mLast[(U8)packet.mData] = packet;
+        mLastValid[(U8)packet.mData] = true;
+    }
+}
+
+void SSDPacketTable::Append(const SSDPacketRecord& packet, U64 nFirstFrame, U64 nLastFrame)
+{
+    // Seul le writer modifie mBlocks: pas de verrou pour le lire ici
+    U32 i = (U32)(mRows & (SSD_PACKET_BLOCK_ROWS - 1));
+    if (i == 0) {
+        Block* block = new Block;
+        std::lock_guard<std::mutex> lock(mLock);
+        mBlocks.push_back(block);
+    }
+    Block& block = *mBlocks.back();
+
+    U8 nCount = PACKET_DATA_COUNT(packet.mInfo);
+    U64 nFrames = nLastFrame - nFirstFrame + 1;
+    block.mStart[i] = packet.mStart;
+    block.mEnd[i] = packet.mEnd;
+    block.mFirstFrame[i] = nFirstFrame;
+    block.mRepeat[i] = (packet.mRepeat < 0xFFFFFFFF) ? (U32)packet.mRepeat : 0xFFFFFFFF;
+    block.mCommand[i] = PACKET_BYTE(packet.mData, 0);
+    for (U8 j = 1; j <= 6; j++)
+        block.mCar[i][j - 1] = (j <= nCount) ? PACKET_BYTE(packet.mData, j) : 0;
+    block.mChecksum[i] = PACKET_BYTE(packet.mData, PACKET_CHECKSUM_INDEX);
+    block.mComputed[i] = PACKET_CALC_CHECKSUM(packet.mInfo);
+    block.mDataCount[i] = nCount;
+    block.mPreambleBits[i] = PACKET_PREAMBLE_BITS(packet.mInfo);
+    block.mFlags[i] = packet.mFlags;
+    block.mFrameCount[i] = (nFrames < 255) ? (U8)nFrames : 255;
+    mRows++;
+}
+
+const SSDPacketTable::Block* SSDPacketTable::GetBlock(U64 nRow) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mBlocks[(size_t)(nRow / SSD_PACKET_BLOCK_ROWS)];
+}
+
+void SSDPacketTable::GetRecord(const Block& block, U32 nIndex, SSDPacketRecord* record)
+{
+    U64 nData = block.mCommand[nIndex] | ((U64)block.mChecksum[nIndex] << (8 * PACKET_CHECKSUM_INDEX));
+    for (U32 j = 0; j < 6; j++)
+        nData |= (U64)block.mCar[nIndex][j] << (8 * (j + 1));
+
+    record->mStart = block.mStart[nIndex];
+    record->mEnd = block.mEnd[nIndex];
+    record->mData = nData;
+    record->mInfo = block.mPreambleBits[nIndex] | ((U64)block.mComputed[nIndex] << 8) | ((U64)block.mDataCount[nIndex] << 16);
+    record->mRepeat = block.mRepeat[nIndex];
+    record->mFlags = block.mFlags[nIndex];
+}
+
+bool SSDPacketTable::GetRecord(U64 nRow, SSDPacketRecord* record) const
+{
+    if (nRow >= GetCount())
+        return false;
+    GetRecord(*GetBlock(nRow), (U32)(nRow & (SSD_PACKET_BLOCK_ROWS - 1)), record);
+    return true;
+}
+
+bool SSDPacketTable::FindFrame(U64 nFrame, U64* nRow) const
+{
+    // Dernier paquet commence au plus tard a nFrame, par dichotomie
+    U64 nCount = GetCount();
+    std::lock_guard<std::mutex> lock(mLock);
+    U64 nLow = 0, nHigh = nCount;
+    while (nLow < nHigh) {
+        U64 nMid = nLow + (nHigh - nLow) / 2;
+        const Block& block = *mBlocks[(size_t)(nMid / SSD_PACKET_BLOCK_ROWS)];
+        if (block.mFirstFrame[nMid & (SSD_PACKET_BLOCK_ROWS - 1)] <= nFrame)
+            nLow = nMid + 1;
+        else
+            nHigh = nMid;
+    }
+    if (nLow == 0)
+        return false;
+
+    const Block& block = *mBlocks[(size_t)((nLow - 1) / SSD_PACKET_BLOCK_ROWS)];
+    U32 i = (U32)((nLow - 1) & (SSD_PACKET_BLOCK_ROWS - 1));
+    if (nFrame - block.mFirstFrame[i] >= block.mFrameCount[i])
+        return false;
+    *nRow = nLow - 1;
+    return true;
+}
+
+void SSDPacketTable::GetTotals(U64* nRows, U64* nPackets, U64* nChecksumErrors) const
+{
+    // Deux colonnes seulement, un bloc a la fois
+    U64 nCount = GetCount();
+    U64 nTotal = 0, nErrors = 0;
+    for (U64 nRow = 0; nRow < nCount; nRow += SSD_PACKET_BLOCK_ROWS) {
+        const Block& block = *GetBlock(nRow);
+        U32 nEnd = (nCount - nRow < SSD_PACKET_BLOCK_ROWS) ? (U32)(nCount - nRow) : SSD_PACKET_BLOCK_ROWS;
+        for (U32 i = 0; i < nEnd; i++) {
+            nTotal += block.mRepeat[i];
+            nErrors += (block.mFlags[i] & CHECKSUM_ERROR_FLAG) != 0;
+        }
+    }
+    *nRows = nCount;
+    *nPackets = nTotal;
+    *nChecksumErrors = nErrors;
+}
+
+U64 SSDPacketTable::GetMemoryBytes() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return (U64)mBlocks.size() * sizeof(Block);
+}
@@ -0,0 +1,91 @@
+#ifndef SSD_PACKET_TABLE_H
+#define SSD_PACKET_TABLE_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "SSDProtocol.h"
+
+// Rows of the packet table in one block (power of 2)
+#ifndef SSD_PACKET_BLOCK_ROWS
+#define SSD_PACKET_BLOCK_ROWS 4096
+#endif
+
+// One packet, in the FRAME_PACKET layout (SSDProtocol.h)
+struct SSDPacketRecord
+{
+    U64 mStart, mEnd;
+    U64 mData;                      // As FRAME_PACKET Data1
+    U64 mInfo;                      // As FRAME_PACKET Data2
+    U64 mRepeat;
+    U8 mFlags;
+};
+
+// Packets of a run, one column per field (struct of arrays), filled from the
+// frames as the analyzer posts them, whatever the frame mode: the frames of a
+// packet (Full, Compact) are grouped, a FRAME_REPEAT row takes the bytes of
+// the last valid packet of its command. Errors drop the packet in progress.
+// About 40 bytes per packet, in blocks of SSD_PACKET_BLOCK_ROWS rows that
+// never move, so the exports scan contiguous memory instead of the frames.
+//
+// One writer (the analyzer thread): AddFrame, then Commit with the frames.
+// Any thread may read the rows below GetCount().
+class SSDPacketTable
+{
+public:
+    struct Block
+    {
+        U64 mStart[SSD_PACKET_BLOCK_ROWS];      // Preamble start (FRAME_REPEAT: first packet)
+        U64 mEnd[SSD_PACKET_BLOCK_ROWS];        // Checksum end
+        U64 mFirstFrame[SSD_PACKET_BLOCK_ROWS]; // Frame index of the preamble, FRAME_PACKET or FRAME_REPEAT
+        U32 mRepeat[SSD_PACKET_BLOCK_ROWS];     // 1, or N for a FRAME_REPEAT run
+        U8 mCommand[SSD_PACKET_BLOCK_ROWS];
+        U8 mCar[SSD_PACKET_BLOCK_ROWS][6];      // 0 past mDataCount
+        U8 mChecksum[SSD_PACKET_BLOCK_ROWS];    // Received
+        U8 mComputed[SSD_PACKET_BLOCK_ROWS];
+        U8 mDataCount[SSD_PACKET_BLOCK_ROWS];
+        U8 mPreambleBits[SSD_PACKET_BLOCK_ROWS];
+        U8 mFlags[SSD_PACKET_BLOCK_ROWS];       // Of the checksum frame
+        U8 mFrameCount[SSD_PACKET_BLOCK_ROWS];  // Frames from mFirstFrame to the checksum (255 at most)
+    };
+
+    SSDPacketTable();
+    ~SSDPacketTable();
+
+    // Writer
+    void AddFrame(U64 nFrame, eFrameType ft, U8 Flags, U64 nStartSample, U64 nEndSample, U64 Data1, U64 Data2);
+    void Commit() { mCommitted.store(mRows, std::memory_order_release); }
+
+    // Readers
+    U64 GetCount() const { return mCommitted.load(std::memory_order_acquire); }
+    const Block* GetBlock(U64 nRow) const;          // Block holding row nRow < GetCount()
+    static void GetRecord(const Block& block, U32 nIndex, SSDPacketRecord* record);
+    bool GetRecord(U64 nRow, SSDPacketRecord* record) const;
+    bool FindFrame(U64 nFrame, U64* nRow) const;    // Row of the packet frame nFrame belongs to
+    U64 GetMemoryBytes() const;
+
+    // Rows below GetCount(), repeat runs counted N times (stats export)
+    void GetTotals(U64* nRows, U64* nPackets, U64* nChecksumErrors) const;
+
+protected:
+    void Append(const SSDPacketRecord& packet, U64 nFirstFrame, U64 nLastFrame);
+
+protected: //vars
+    std::vector<Block*> mBlocks;    // Grows under mLock, blocks freed with the table
+    mutable std::mutex mLock;
+    U64 mRows;                      // Rows written (writer only)
+    std::atomic<U64> mCommitted;    // Rows readers may use
+
+    // Packet being assembled from its frames
+    bool mOpen;
+    SSDPacketRecord mPacket;
+    U64 mPacketFrame;
+    SSDPacketRecord mLast[256];     // Last valid packet of each command (FRAME_REPEAT)
+    bool mLastValid[256];
+
+private:
+    SSDPacketTable(const SSDPacketTable&);
+    SSDPacketTable& operator=(const SSDPacketTable&);
+};
+
+#endif //SSD_PACKET_TABLE_H
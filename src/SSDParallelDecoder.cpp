@@ -0,0 +1,290 @@
+#include "SSDParallelDecoder.h"
+#include <AnalyzerChannelData.h>
+#include <thread>
+
+// Intervals left after the last chunk, so that no Step() runs out of data
+// before reaching the end of its chunk
+#define CHUNK_MARGIN 256
+
+SSDBufferedOutput::SSDBufferedOutput()
+    : mProgress(0)
+{
+}
+
+void SSDBufferedOutput::OnFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2, U8 nPacketMode)
+{
+    Event event;
+    event.mStart = nStartSample;
+    event.mEnd = nEndSample;
+    event.mData1 = Data1;
+    event.mData2 = Data2;
+    event.mType = (U8)ft;
+    event.mFlags = Flags;
+    event.mPacketMode = nPacketMode;
+    mEvents.push_back(event);
+}
+
+void SSDBufferedOutput::OnMarker(U64 nSample, eMarkerType marker)
+{
+    Event event;
+    event.mStart = nSample;
+    event.mEnd = nSample;
+    event.mData1 = 0;
+    event.mData2 = 0;
+    event.mType = EVENT_MARKER;
+    event.mFlags = (U8)marker;
+    event.mPacketMode = 0;
+    mEvents.push_back(event);
+}
+
+void SSDBufferedOutput::OnProgress(U64 nSample)
+{
+    mProgress = nSample;
+}
+
+void SSDBufferedOutput::Clear()
+{
+    mEvents.clear();
+    mProgress = 0;
+}
+
+void SSDBufferedOutput::Replay(SSDDecoderOutput* output) const
+{
+    for (size_t i = 0; i < mEvents.size(); i++) {
+        const Event& event = mEvents[i];
+        if (event.mType == EVENT_MARKER)
+            output->OnMarker(event.mStart, (eMarkerType)event.mFlags);
+        else
+            output->OnFrame(event.mStart, event.mEnd, (eFrameType)event.mType, event.mFlags,
+                            event.mData1, event.mData2, event.mPacketMode);
+    }
+
+    if (mProgress != 0)
+        output->OnProgress(mProgress);
+}
+
+static void DecodeChunk(SSDChannelDecoder* decoder, U64 nStop, U8* bDone)
+{
+    // Runs on a worker thread: nothing here may reach the SDK
+    try {
+        decoder->GetEdges().SetScanLimit(nStop);
+        while (decoder->GetEdges().GetConsumed() < nStop)
+            decoder->Step();
+        *bDone = 1;
+    }
+    catch (...) {
+        *bDone = 0;
+    }
+}
+
+SSDParallelDecoder::SSDParallelDecoder()
+    : mThreads(1),
+    mStartSample(0),
+    mLongLast(0),
+    mLastBatch(false)
+{
+}
+
+SSDParallelDecoder::~SSDParallelDecoder()
+{
+}
+
+void SSDParallelDecoder::Init(U32 nThreads, U64 nStartSample, const U32* intervals, U32 nCount, U64 nLongLast)
+{
+    mThreads = (nThreads < 1) ? 1 : nThreads;
+    mIntervals.assign(intervals, intervals + nCount);
+    mStartSample = nStartSample;
+    mLongLast = nLongLast;
+    mLastBatch = false;
+
+    // Un INTERVAL_LONG ne peut etre que le dernier: rien a lire en plus
+    if (nCount != 0 && intervals[nCount - 1] == INTERVAL_LONG)
+        mLastBatch = true;
+}
+
+void SSDParallelDecoder::ReadBatch(AnalyzerChannelData* channel)
+{
+    // Only what the host already has: waiting for live data is left to the serial decoder
+    size_t nTarget = (size_t)mThreads * SSD_PARALLEL_CHUNK_EDGES;
+    if (mLastBatch)
+        return;
+
+    // Dernier front lu sur le canal (le filtre peut retenir les derniers intervalles)
+    U64 nLast = channel->GetSampleNumber();
+
+    while (mIntervals.size() < nTarget) {
+        if (!channel->DoMoreTransitionsExistInCurrentData()) {
+            mLastBatch = true;
+            break;
+        }
+
+        channel->AdvanceToNextEdge();
+        U64 nEdge = channel->GetSampleNumber();
+        U64 nInterval;
+        bool bReady = mDeglitch.Push(nEdge - nLast, &nInterval);
+        nLast = nEdge;
+        if (!bReady)
+            continue;
+
+        if (nInterval >= INTERVAL_LONG) {
+            // Doit rester la derniere entree: la suite est decodee en serie
+            mLongLast = nInterval;
+            mIntervals.push_back(INTERVAL_LONG);
+            mLastBatch = true;
+            break;
+        }
+
+        mIntervals.push_back((U32)nInterval);
+    }
+}
+
+void SSDParallelDecoder::FindChunks(const SSDChannelDecoder& decoder)
+{
+    // Chunk 0 continues from the real decoder state, the others start two
+    // edges after a packet gap, where FSTATE_PEBIT leaves the decoder idle
+    mChunkStart.assign(1, 0);
+    mChunkSample.assign(1, mStartSample);
+
+    U32 nCount = (U32)mIntervals.size();
+    if (nCount <= CHUNK_MARGIN)
+        return;
+
+    U32 nLast = nCount - CHUNK_MARGIN;
+    U32 nLen = nLast / mThreads;
+    U32 nMinGap = decoder.GetLimits().mMax0hbit;
+    U64 nSample = mStartSample;
+    U32 i = 0;
+
+    for (U32 k = 1; k < mThreads; k++) {
+        for (; i < k * nLen; i++)
+            nSample += mIntervals[i];
+
+        while (i + 2 < nLast && (mIntervals[i] <= nMinGap || decoder.ClassifyHBit(mIntervals[i]) != HBIT_GAP))
+            nSample += mIntervals[i++];
+        if (i + 2 >= nLast)
+            break;
+
+        nSample += (U64)mIntervals[i] + mIntervals[i + 1];
+        i += 2;
+        mChunkStart.push_back(i);
+        mChunkSample.push_back(nSample);
+    }
+}
+
+bool SSDParallelDecoder::DecodeBatch(SSDChannelDecoder& decoder, AnalyzerChannelData* channel)
+{
+    ReadBatch(channel);
+
+    U32 nCount = (U32)mIntervals.size();
+    if (nCount <= CHUNK_MARGIN) {
+        Finish(decoder, channel);
+        return false;
+    }
+
+    FindChunks(decoder);
+
+    U32 nChunks = (U32)mChunkStart.size();
+    U32 nLast = nCount - CHUNK_MARGIN;
+    SSDDecoderOutput* output = decoder.GetOutput();
+
+    std::vector<SSDChannelDecoder> decoders(nChunks, decoder);
+    std::vector<U8> done(nChunks, 0);
+    std::vector<std::thread> threads;
+    mChunkOutput.resize(nChunks);
+
+    for (U32 k = 0; k < nChunks; k++) {
+        if (k != 0)
+            decoders[k].ResetIdle(mChunkSample[k]);
+        SSDMemorySource memory(mIntervals.data() + mChunkStart[k], nCount - mChunkStart[k], &mLongLast);
+        decoders[k].GetEdges().Init(SSDChannelSource(memory, NULL), mChunkSample[k]);
+        if (k != 0)
+            decoders[k].ClearStats();   // Ceux des chunks precedents sont ajoutes au merge
+        mChunkOutput[k].Clear();
+        decoders[k].SetOutput(&mChunkOutput[k]);
+    }
+
+    for (U32 k = 1; k < nChunks; k++) {
+        U32 nStop = (k + 1 < nChunks) ? mChunkStart[k + 1] : nLast;
+        try {
+            threads.push_back(std::thread(DecodeChunk, &decoders[k], (U64)(nStop - mChunkStart[k]), &done[k]));
+        }
+        catch (...) {
+            break;      // Chunks not started are decoded in the merge below
+        }
+    }
+
+    DecodeChunk(&decoders[0], (nChunks > 1) ? mChunkStart[1] : nLast, &done[0]);
+
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+
+    // Merge in sample order. current holds the real decoder state at the end
+    // of the chunks merged so far.
+    SSDChannelDecoder* current = NULL;
+    U32 nCurrentStart = 0;
+
+    for (U32 k = 0; k < nChunks; k++) {
+        U32 nStop = (k + 1 < nChunks) ? mChunkStart[k + 1] : nLast;
+        bool bValid = (done[k] != 0);
+
+        if (bValid && current != NULL)
+            bValid = (nCurrentStart + current->GetEdges().GetConsumed() == mChunkStart[k]) &&
+                     current->IsIdleAt(mChunkSample[k]);
+
+        if (bValid) {
+            mChunkOutput[k].Replay(output);
+            if (current != NULL)
+                decoders[k].AddStats(*current);
+            current = &decoders[k];
+            nCurrentStart = mChunkStart[k];
+            continue;
+        }
+
+        // Mauvaise supposition (ou chunk non termine): on le refait a partir de l'etat reel
+        if (current == NULL) {
+            decoders[0] = decoder;
+            SSDMemorySource memory(mIntervals.data(), nCount, &mLongLast);
+            decoders[0].GetEdges().Init(SSDChannelSource(memory, NULL), mStartSample);
+            current = &decoders[0];
+            nCurrentStart = 0;
+        }
+
+        current->SetOutput(output);
+        current->GetEdges().GetSource().SetChannel(channel);
+        current->GetEdges().GetSource().SetDeglitch(mDeglitch);
+        current->GetEdges().SetScanLimit(nStop - nCurrentStart);
+        while (nCurrentStart + current->GetEdges().GetConsumed() < nStop)
+            current->Step();
+
+        if (current->GetEdges().GetSource().IsOnChannel()) {
+            // Tout ce qui avait ete lu est decode, le decodeur est deja sur le canal
+            decoder = *current;
+            decoder.SetOutput(output);
+            decoder.GetEdges().SetScanLimit(~(U64)0);
+            mIntervals.clear();
+            return false;
+        }
+        current->GetEdges().GetSource().SetChannel(NULL);
+    }
+
+    // Keep the intervals not consumed yet for the next batch
+    U32 nConsumed = nCurrentStart + (U32)current->GetEdges().GetConsumed();
+    mStartSample = current->GetEdges().GetSampleNumber();
+    decoder = *current;
+    decoder.SetOutput(output);
+    mIntervals.erase(mIntervals.begin(), mIntervals.begin() + nConsumed);
+
+    if (mLastBatch) {
+        Finish(decoder, channel);
+        return false;
+    }
+    return true;
+}
+
+void SSDParallelDecoder::Finish(SSDChannelDecoder& decoder, AnalyzerChannelData* channel)
+{
+    SSDMemorySource memory(mIntervals.data(), mIntervals.size(), &mLongLast);
+    SSDChannelSource source(memory, channel);
+    source.SetDeglitch(mDeglitch);
+    decoder.GetEdges().Init(source, mStartSample);
+}
@@ -0,0 +1,81 @@
+#ifndef SSD_PARALLEL_DECODER_H
+#define SSD_PARALLEL_DECODER_H
+
+#include <vector>
+#include "SSDChannelSource.h"
+
+// Edges per chunk given to one thread
+#ifndef SSD_PARALLEL_CHUNK_EDGES
+#define SSD_PARALLEL_CHUNK_EDGES 262144
+#endif
+
+// Records the decoder output of one chunk so it can be replayed in order
+class SSDBufferedOutput : public SSDDecoderOutput
+{
+public:
+    SSDBufferedOutput();
+
+    virtual void OnFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2, U8 nPacketMode);
+    virtual void OnMarker(U64 nSample, eMarkerType marker);
+    virtual void OnProgress(U64 nSample);
+
+    void Clear();
+    void Replay(SSDDecoderOutput* output) const;
+
+protected:
+    struct Event
+    {
+        U64 mStart, mEnd;
+        U64 mData1, mData2;
+        U8 mType;                   // eFrameType, or EVENT_MARKER
+        U8 mFlags;                  // Frame flags, or eMarkerType
+        U8 mPacketMode;
+    };
+    enum { EVENT_MARKER = 0xFF };
+
+    std::vector<Event> mEvents;
+    U64 mProgress;
+};
+
+// Decodes the edges the host already has, split in chunks at the gaps
+// between packets, one thread per chunk.
+// A chunk is decoded from the state the decoder is in after a packet gap
+// (SSDDecoderBase::ResetIdle). Once the previous chunk is done, its real end state
+// is compared with that guess: if it differs the chunk is decoded again from
+// the real state, so the output is always the one of the serial decoder.
+class SSDParallelDecoder
+{
+public:
+    SSDParallelDecoder();
+    ~SSDParallelDecoder();
+
+    // intervals: edges already read from the channel after nStartSample
+    // (auto calibration), decoded before the ones read by DecodeBatch
+    void Init(U32 nThreads, U64 nStartSample, const U32* intervals = NULL, U32 nCount = 0, U64 nLongLast = 0);
+    void SetDeglitch(const SSDDeglitch& deglitch) { mDeglitch = deglitch; }   // Filter state at mEndSample
+
+    // Reads the next batch from channel and decodes it into decoder's output.
+    // Returns false once the channel has no more data immediately available:
+    // decoder then goes on serially with what is left (memory, then channel).
+    bool DecodeBatch(SSDChannelDecoder& decoder, AnalyzerChannelData* channel);
+
+protected:
+    void ReadBatch(AnalyzerChannelData* channel);
+    void FindChunks(const SSDChannelDecoder& decoder);
+    void Finish(SSDChannelDecoder& decoder, AnalyzerChannelData* channel);
+
+protected: //vars
+    U32 mThreads;
+
+    std::vector<U32> mIntervals;    // Intervals read but not decoded yet
+    U64 mStartSample;               // Sample of the edge before mIntervals[0]
+    SSDDeglitch mDeglitch;          // Handed to the channel source once the batches are done
+    U64 mLongLast;                  // Value behind a last INTERVAL_LONG entry
+    bool mLastBatch;
+
+    std::vector<U32> mChunkStart;   // Index of the first interval of each chunk
+    std::vector<U64> mChunkSample;  // Sample of the edge before it
+    std::vector<SSDBufferedOutput> mChunkOutput;
+};
+
+#endif //SSD_PARALLEL_DECODER_H
@@ -0,0 +1,61 @@
+#ifndef SSD_PROTOCOL_H
+#define SSD_PROTOCOL_H
+
+// Definitions shared by the decoder and the Logic 2 front end.
+// No SDK header here: the decoder core builds without the AnalyzerSDK.
+
+#include <stddef.h>
+
+// Same types as LogicPublicTypes.h (identical typedefs may be repeated)
+typedef unsigned char U8;
+typedef unsigned short U16;
+typedef unsigned int U32;
+typedef unsigned long long int U64;
+typedef int S32;
+typedef long long int S64;
+
+#define BIT_ERROR_FLAG ( 1 << 1 )
+#define PACKET_ERROR_FLAG ( 1 << 2 )
+#define FRAMING_ERROR_FLAG (1 << 3)
+#define CHECKSUM_ERROR_FLAG (1 << 4)
+#define RECOVERED_FLAG (1 << 5)       // Un demi-bit entre les fenetres corrige (octet, checksum, paquet)
+
+enum eFrameType { 
+    FRAME_PREAMBLE, 
+    FRAME_PSBIT,        // Packet Start Bit
+    FRAME_CMDBYTE,      // Command Byte (RACE or PROGRAM)
+    FRAME_DSBIT,        // Data Start Bit
+    FRAME_CARDATA,      // Car Data Byte
+    FRAME_CHECKSUM,     // Checksum Byte
+    FRAME_PEBIT,        // Packet End Bit
+    FRAME_ERR,          // Error Frame
+    FRAME_END_ERR,      // End Error Frame
+    FRAME_PACKET,       // Whole packet (frame mode "Packet")
+    FRAME_REPEAT,       // Packets identical to the previous one of the same command
+    FRAME_ERR_SPAN      // Consecutive errors coalesced (decoder resync mode)
+};
+
+// FRAME_PACKET: Data1 = octets du paquet, commande en poids faible, donnees 1-6, checksum en poids fort
+//               Data2 = bits de preambule | checksum calcule << 8 | nombre d'octets de donnees << 16
+#define PACKET_BYTE(data1, i)           ((U8)((data1) >> (8 * (i))))
+#define PACKET_CHECKSUM_INDEX           7
+#define PACKET_PREAMBLE_BITS(data2)     ((U8)(data2))
+#define PACKET_CALC_CHECKSUM(data2)     ((U8)((data2) >> 8))
+#define PACKET_DATA_COUNT(data2)        ((U8)((data2) >> 16))
+
+// FRAME_REPEAT: Data1 = nombre de paquets, Data2 = commande.
+//               Les paquets repetent le dernier paquet complet de cette commande.
+
+// FRAME_ERR_SPAN: Data1 = nombre d'erreurs, Flags = OU des flags des erreurs.
+//                 Va du debut de la premiere erreur a la fin de la derniere.
+
+// Markers placed by the decoder, mapped onto AnalyzerResults::MarkerType by SSDAnalyzer
+enum eMarkerType {
+    MARKER_START,
+    MARKER_STOP,
+    MARKER_ERROR_DOT,
+    MARKER_ERROR_SQUARE,
+    MARKER_ERROR_X
+};
+
+#endif //SSD_PROTOCOL_H
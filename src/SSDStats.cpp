@@ -0,0 +1,323 @@
+#include "SSDStats.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Meme ordre que eFrameState
+static const char* sStateNames[SSD_STATS_STATES] = {
+    "init", "preamble", "packet_start_bit", "command", "data_start_bit",
+    "checksum_start_bit", "data", "checksum", "packet_end_bit"
+};
+
+// Meme ordre que les classes de demi-bits (HBIT_0 = 0 ... HBIT_GAP = 3)
+static const char* sClassNames[SSD_STATS_CLASSES] = { "zero", "one", "error", "gap" };
+
+// Bits de flag des erreurs (SSDProtocol.h). Le bit 0 vient d'un gap
+// (HBIT_GAP = 3) dans le preambule, avec le bit 1.
+static const char* sFlagNames[8] = { "gap", "bit", "packet", "framing", "checksum", "flag5", "flag6", "flag7" };
+
+static U64 MeasureOverhead()
+{
+    // Le plus petit ecart entre deux lectures de l'horloge
+    U64 nMin = ~(U64)0;
+    for (int i = 0; i < 64; i++) {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        U64 nNs = (U64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        nMin = (nNs < nMin) ? nNs : nMin;
+    }
+    return nMin;
+}
+
+U64 SSDProfileOverheadNs()
+{
+    static const U64 sOverhead = MeasureOverhead();
+    return sOverhead;
+}
+
+void SSDDecoderStats::Clear()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+void SSDDecoderStats::Add(const SSDDecoderStats& stats)
+{
+    // Uniquement des compteurs U64: on les additionne un par un
+    const U64* nFrom = (const U64*)&stats;
+    U64* nTo = (U64*)this;
+    for (size_t i = 0; i < sizeof(*this) / sizeof(U64); i++)
+        nTo[i] += nFrom[i];
+}
+
+U64 SSDDecoderStats::GetPackets() const
+{
+    U64 nPackets = 0;
+    for (int i = 0; i < 256; i++)
+        nPackets += mPackets[i];
+    return nPackets;
+}
+
+U64 SSDDecoderStats::GetErrors() const
+{
+    return mErrorEvents;
+}
+
+SSDRunStats::SSDRunStats()
+    : mSampleRateHz(0),
+    mThreads(1),
+    mStartSample(0),
+    mEndSample(0),
+    mWallSeconds(0.0),
+    mTableRows(0),
+    mTablePackets(0),
+    mTableChecksumErrors(0),
+    mTableBytes(0)
+{
+    mDecoder.Clear();
+    memset(&mLimits, 0, sizeof(mLimits));
+}
+
+static void Append(std::string* json, const char* format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    *json += buffer;
+}
+
+void SSDRunStats::WriteJson(std::string* json) const
+{
+    const SSDDecoderStats& d = mDecoder;
+    double dCapture = (mSampleRateHz != 0 && mEndSample > mStartSample) ? (double)(mEndSample - mStartSample) / mSampleRateHz : 0.0;
+    double dWall = (mWallSeconds > 0.0) ? mWallSeconds : 0.0;
+    U64 nPackets = d.GetPackets();
+
+    json->clear();
+    Append(json, "{\n  \"sample_rate_hz\": %u,\n  \"threads\": %u,\n", mSampleRateHz, mThreads);
+    Append(json, "  \"capture\": { \"start_sample\": %llu, \"end_sample\": %llu, \"seconds\": %.6f },\n",
+           (unsigned long long)mStartSample, (unsigned long long)mEndSample, dCapture);
+    Append(json, "  \"wall_seconds\": %.6f,\n", dWall);
+    Append(json, "  \"throughput\": { \"edges_per_second\": %.0f, \"packets_per_second\": %.0f, \"realtime_factor\": %.2f },\n",
+           (dWall > 0.0) ? d.mEdges / dWall : 0.0, (dWall > 0.0) ? nPackets / dWall : 0.0,
+           (dWall > 0.0) ? dCapture / dWall : 0.0);
+    Append(json, "  \"edges\": %llu,\n", (unsigned long long)d.mEdges);
+
+    *json += "  \"half_bits\": {";
+    for (int i = 0; i < SSD_STATS_CLASSES; i++)
+        Append(json, "%s \"%s\": %llu", (i == 0) ? "" : ",", sClassNames[i], (unsigned long long)d.mHBits[i]);
+    *json += " },\n";
+
+    Append(json, "  \"packets\": {\n    \"total\": %llu,\n    \"checksum_errors\": %llu,\n    \"recovered\": %llu,\n    \"by_command\": {",
+           (unsigned long long)nPackets, (unsigned long long)d.mChecksumErrors, (unsigned long long)d.mRecovered);
+    bool bFirst = true;
+    for (int i = 0; i < 256; i++) {
+        if (d.mPackets[i] == 0)
+            continue;
+        Append(json, "%s \"0x%02X\": %llu", bFirst ? "" : ",", i, (unsigned long long)d.mPackets[i]);
+        bFirst = false;
+    }
+    *json += " }\n  },\n";
+
+    if (mTableBytes != 0)
+        Append(json, "  \"packet_table\": { \"rows\": %llu, \"packets\": %llu, \"checksum_errors\": %llu, \"bytes\": %llu, \"bytes_per_row\": %.1f },\n",
+               (unsigned long long)mTableRows, (unsigned long long)mTablePackets, (unsigned long long)mTableChecksumErrors,
+               (unsigned long long)mTableBytes, (mTableRows != 0) ? (double)mTableBytes / mTableRows : 0.0);
+
+    Append(json, "  \"errors\": {\n    \"total\": %llu,\n    \"by_flag\": {", (unsigned long long)d.GetErrors());
+    bFirst = true;
+    for (int i = 0; i < 8; i++) {
+        if (d.mErrors[i] == 0)
+            continue;
+        Append(json, "%s \"%s\": %llu", bFirst ? "" : ",", sFlagNames[i], (unsigned long long)d.mErrors[i]);
+        bFirst = false;
+    }
+    Append(json, " }\n  },\n  \"resyncs\": %llu,\n", (unsigned long long)d.mResyncs);
+
+    // Temps estime: un pas sur SSD_PROFILE_PERIOD mesure. La part de chaque
+    // etat est plus fiable que la somme (les pas mesures sont un peu plus lents).
+    U64 nTotalNs = 0;
+    for (int i = 0; i < SSD_STATS_STATES; i++)
+        nTotalNs += d.mStateNs[i];
+
+    *json += "  \"states\": {\n";
+    for (int i = 0; i < SSD_STATS_STATES; i++)
+        Append(json, "    \"%s\": { \"steps\": %llu, \"time_ms\": %.3f, \"share\": %.4f }%s\n", sStateNames[i],
+               (unsigned long long)d.mSteps[i], d.mStateNs[i] / 1e6,
+               (nTotalNs != 0) ? (double)d.mStateNs[i] / nTotalNs : 0.0, (i + 1 < SSD_STATS_STATES) ? "," : "");
+    *json += "  }\n}\n";
+}
+
+SSDTimingHistogram::SSDTimingHistogram()
+    : mScale(0),
+    mSampleRateHz(0)
+{
+    Clear();
+}
+
+void SSDTimingHistogram::SetSampleRate(U32 nSampleRateHz)
+{
+    mSampleRateHz = nSampleRateHz;
+    mScale = (nSampleRateHz == 0) ? 0 : (U64)((double)SSD_TIMING_BINS_PER_US * 1000000.0 * 65536.0 / nSampleRateHz + 0.5);
+    Clear();
+}
+
+void SSDTimingHistogram::Add(const SSDTimingHistogram& histogram)
+{
+    for (U32 i = 0; i < SSD_TIMING_BINS; i++)
+        mBins[i] += histogram.mBins[i];
+    for (U32 i = 0; i < SSD_TIMING_GAP_BINS; i++)
+        mGapBins[i] += histogram.mGapBins[i];
+}
+
+void SSDTimingHistogram::Clear()
+{
+    memset(mBins, 0, sizeof(mBins));
+    memset(mGapBins, 0, sizeof(mGapBins));
+}
+
+void SSDTimingHistogram::GetBins(double dFromUs, double dToUs, std::vector<Bin>* bins) const
+{
+    // Une classe appartient a l'intervalle qui contient son debut.
+    // La derniere classe des gaps (debordement) n'a pas de fin: jamais prise.
+    bins->clear();
+    for (U32 i = 0; i < SSD_TIMING_BINS; i++) {
+        Bin bin = { (double)i / SSD_TIMING_BINS_PER_US, 1.0 / SSD_TIMING_BINS_PER_US, mBins[i] };
+        if (bin.mCount != 0 && bin.mStart >= dFromUs && bin.mStart < dToUs)
+            bins->push_back(bin);
+    }
+    for (U32 i = SSD_TIMING_BINS / (SSD_TIMING_GAP_BIN_US * SSD_TIMING_BINS_PER_US); i + 1 < SSD_TIMING_GAP_BINS; i++) {
+        Bin bin = { (double)i * SSD_TIMING_GAP_BIN_US, SSD_TIMING_GAP_BIN_US, mGapBins[i] };
+        if (bin.mCount != 0 && bin.mStart >= dFromUs && bin.mStart < dToUs)
+            bins->push_back(bin);
+    }
+}
+
+static bool LessDeviation(const std::pair<double, U64>& a, const std::pair<double, U64>& b)
+{
+    return a.first < b.first;
+}
+
+void SSDTimingHistogram::GetSummary(const SSDHBitLimits& limits, ePopulation population, SSDTimingSummary* summary) const
+{
+    memset(summary, 0, sizeof(*summary));
+    if (!IsEnabled())
+        return;
+
+    // Populations autour des fenetres, separees a mi-chemin entre elles:
+    // un '1' a 66us sort de sa fenetre mais reste compte comme un '1'
+    double dMin1 = ToMicroseconds(limits.mMin1hbit), dMax1 = ToMicroseconds(limits.mMax1hbit);
+    double dMin0 = ToMicroseconds(limits.mMin0hbit), dMax0 = ToMicroseconds(limits.mMax0hbit);
+    double dMargin = (dMin0 - dMax1) / 2;
+    double dFrom, dTo;
+
+    switch (population) {
+    case POPULATION_1HBIT:
+        summary->mWindowMin = dMin1;
+        summary->mWindowMax = dMax1;
+        dFrom = dMin1 - dMargin;
+        dTo = dMax1 + dMargin;
+        break;
+    case POPULATION_0HBIT:
+        summary->mWindowMin = dMin0;
+        summary->mWindowMax = dMax0;
+        dFrom = dMin0 - dMargin;
+        dTo = dMax0 + dMargin;
+        break;
+    default:
+        summary->mWindowMin = dMax0;
+        summary->mWindowMax = ToMicroseconds(limits.mMaxPGap);
+        dFrom = dMax0 + dMargin;
+        dTo = 1e12;
+        break;
+    }
+
+    std::vector<Bin> bins;
+    GetBins(dFrom, dTo, &bins);
+    if (bins.empty())
+        return;
+
+    // Resolution: une classe. Le min et le max sont les bords de la premiere
+    // et de la derniere, la moyenne prend le milieu de chacune.
+    double dSum = 0.0, dSquares = 0.0;
+    for (size_t i = 0; i < bins.size(); i++) {
+        double dCenter = bins[i].mStart + bins[i].mWidth / 2;
+        summary->mCount += bins[i].mCount;
+        dSum += dCenter * bins[i].mCount;
+        dSquares += dCenter * dCenter * bins[i].mCount;
+        if (dCenter < summary->mWindowMin || dCenter > summary->mWindowMax)
+            summary->mOutside += bins[i].mCount;
+    }
+    summary->mMin = bins.front().mStart;
+    summary->mMax = bins.back().mStart + bins.back().mWidth;
+    summary->mMean = dSum / summary->mCount;
+    double dVariance = dSquares / summary->mCount - summary->mMean * summary->mMean;
+    summary->mStdDev = (dVariance > 0.0) ? sqrt(dVariance) : 0.0;
+
+    // Ecart a la moyenne qui contient 99% des intervalles
+    std::vector<std::pair<double, U64> > deviations;
+    for (size_t i = 0; i < bins.size(); i++)
+        deviations.push_back(std::make_pair(fabs(bins[i].mStart + bins[i].mWidth / 2 - summary->mMean) + bins[i].mWidth / 2, bins[i].mCount));
+    std::sort(deviations.begin(), deviations.end(), LessDeviation);
+
+    U64 nTarget = summary->mCount - summary->mCount / 100;
+    U64 nSeen = 0;
+    for (size_t i = 0; i < deviations.size(); i++) {
+        nSeen += deviations[i].second;
+        if (nSeen >= nTarget) {
+            summary->mJitter99 = deviations[i].first;
+            break;
+        }
+    }
+}
+
+static void AppendSummary(std::string* json, const char* name, const SSDTimingSummary& s, bool bLast)
+{
+    Append(json, "    \"%s\": { \"count\": %llu, \"min_us\": %.2f, \"max_us\": %.2f, \"mean_us\": %.3f, \"stddev_us\": %.3f, \"jitter_p99_us\": %.2f,\n",
+           name, (unsigned long long)s.mCount, s.mMin, s.mMax, s.mMean, s.mStdDev, s.mJitter99);
+    Append(json, "      \"window_us\": [%.2f, %.2f], \"margin_low_us\": %.2f, \"margin_high_us\": %.2f, \"outside\": %llu }%s\n",
+           s.mWindowMin, s.mWindowMax, (s.mCount != 0) ? s.mMin - s.mWindowMin : 0.0,
+           (s.mCount != 0) ? s.mWindowMax - s.mMax : 0.0, (unsigned long long)s.mOutside, bLast ? "" : ",");
+}
+
+void SSDTimingHistogram::WriteJson(const SSDHBitLimits& limits, std::string* json) const
+{
+    json->clear();
+    if (!IsEnabled()) {
+        *json = "{ \"enabled\": false }\n";
+        return;
+    }
+
+    SSDTimingSummary ones, zeros, gaps;
+    GetSummary(limits, POPULATION_1HBIT, &ones);
+    GetSummary(limits, POPULATION_0HBIT, &zeros);
+    GetSummary(limits, POPULATION_GAP, &gaps);
+
+    Append(json, "{\n  \"enabled\": true,\n  \"sample_rate_hz\": %u,\n  \"summary\": {\n", mSampleRateHz);
+    AppendSummary(json, "one", ones, false);
+    AppendSummary(json, "zero", zeros, false);
+    AppendSummary(json, "gap", gaps, true);
+    *json += "  },\n";
+
+    // Classes non vides seulement: [debut en us, nombre]
+    Append(json, "  \"half_bits\": { \"bin_us\": %.2f, \"bins\": [", 1.0 / SSD_TIMING_BINS_PER_US);
+    bool bFirst = true;
+    for (U32 i = 0; i < SSD_TIMING_BINS; i++) {
+        if (mBins[i] == 0)
+            continue;
+        Append(json, "%s[%.2f, %llu]", bFirst ? "" : ", ", (double)i / SSD_TIMING_BINS_PER_US, (unsigned long long)mBins[i]);
+        bFirst = false;
+    }
+    Append(json, "] },\n  \"gaps\": { \"bin_us\": %d, \"bins\": [", SSD_TIMING_GAP_BIN_US);
+    bFirst = true;
+    for (U32 i = 0; i < SSD_TIMING_GAP_BINS; i++) {
+        if (mGapBins[i] == 0)
+            continue;
+        Append(json, "%s[%u, %llu]", bFirst ? "" : ", ", i * SSD_TIMING_GAP_BIN_US, (unsigned long long)mGapBins[i]);
+        bFirst = false;
+    }
+    Append(json, "], \"overflow_from_us\": %u }\n}\n", (SSD_TIMING_GAP_BINS - 1) * SSD_TIMING_GAP_BIN_US);
+}
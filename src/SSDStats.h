@@ -0,0 +1,131 @@
+#ifndef SSD_STATS_H
+#define SSD_STATS_H
+
+#include <string>
+#include <vector>
+#include "SSDProtocol.h"
+#include "SSDHBitKernel.h"
+
+#define SSD_STATS_STATES        9       // Un compteur par eFrameState
+#define SSD_STATS_CLASSES       4       // HBIT_0, HBIT_1, HBIT_ERR, HBIT_GAP
+#define SSD_PROFILE_PERIOD      64      // SSD_FEATURE_PROFILE: un Step() sur 64 chronometre (puissance de 2)
+
+// Decoder counters. Everything is counted where the decoder already takes
+// the decision (packet end, error), so keeping them costs a few increments
+// per packet. The step counts and times per state need SSD_FEATURE_PROFILE.
+struct SSDDecoderStats
+{
+    U64 mEdges;                             // Intervals consumed
+    U64 mHBits[SSD_STATS_CLASSES];          // Consumed intervals by half-bit class
+    U64 mPackets[256];                      // Packets with a good checksum, by command
+    U64 mChecksumErrors;
+    U64 mRecovered;                         // Good packets after a single-bit recovery
+    U64 mErrors[8];                         // Bit, framing... errors, by flag bit (a gap only under bit 0)
+    U64 mErrorEvents;                       // Errors, one per event: the sum of mErrors
+    U64 mResyncs;                           // Preambles found again after errors
+    U64 mSteps[SSD_STATS_STATES];           // Step() calls by state
+    U64 mStateNs[SSD_STATS_STATES];         // Estimated time in Step() by state
+
+    void Clear();
+    void Add(const SSDDecoderStats& stats);
+    U64 GetPackets() const;
+    U64 GetErrors() const;
+};
+
+#define SSD_TIMING_BINS_PER_US  4       // Demi-bits: classes de 0.25us...
+#define SSD_TIMING_BINS         800     // ... jusqu'a 200us
+#define SSD_TIMING_GAP_BIN_US   50      // Au-dela (gaps): classes de 50us...
+#define SSD_TIMING_GAP_BINS     1024    // ... jusqu'a 51.2ms, la derniere prend tout ce qui depasse
+
+// Min/max/mean of one population of intervals, against its timing window (us)
+struct SSDTimingSummary
+{
+    U64 mCount;
+    U64 mOutside;                   // Out of [mWindowMin, mWindowMax]
+    double mMin, mMax, mMean;
+    double mStdDev;
+    double mJitter99;               // 99% of the intervals are within mMean +/- mJitter99
+    double mWindowMin, mWindowMax;
+};
+
+// Fixed-bin histogram of the interval lengths ("Timing Report"). The edge
+// ring adds each block as it classifies it, so it costs one multiply per
+// edge and no pass of its own. It does not depend on the timing windows:
+// the '1', '0' and gap populations are only split by GetSummary, with the
+// windows of the moment (Adaptive mode moves them).
+class SSDTimingHistogram
+{
+public:
+    SSDTimingHistogram();
+
+    void SetSampleRate(U32 nSampleRateHz);      // 0: off. Clears the bins
+    bool IsEnabled() const { return mScale != 0; }
+    U32 GetSampleRate() const { return mSampleRateHz; }
+
+    void Add(const U32* intervals, U32 nCount) { Count(intervals, nCount, 1); }
+    void Remove(const U32* intervals, U32 nCount) { Count(intervals, nCount, ~(U64)0); }
+    void Add(const SSDTimingHistogram& histogram);
+    void Clear();
+
+    enum ePopulation { POPULATION_1HBIT, POPULATION_0HBIT, POPULATION_GAP };
+    void GetSummary(const SSDHBitLimits& limits, ePopulation population, SSDTimingSummary* summary) const;
+    void WriteJson(const SSDHBitLimits& limits, std::string* json) const;
+
+protected:
+    void Count(const U32* intervals, U32 nCount, U64 nDelta)
+    {
+        // nDelta = ~0: retire (compteurs modulo 2^64)
+        for (U32 i = 0; i < nCount; i++) {
+            U64 nBin = ((U64)intervals[i] * mScale) >> 16;
+            if (nBin < SSD_TIMING_BINS) {
+                mBins[nBin] += nDelta;
+            }
+            else {
+                nBin /= SSD_TIMING_GAP_BIN_US * SSD_TIMING_BINS_PER_US;
+                mGapBins[(nBin < SSD_TIMING_GAP_BINS) ? nBin : SSD_TIMING_GAP_BINS - 1] += nDelta;
+            }
+        }
+    }
+
+    // Bins (debut en us, largeur, nombre) de [dFromUs, dToUs[, toutes tailles confondues
+    struct Bin
+    {
+        double mStart, mWidth;
+        U64 mCount;
+    };
+    void GetBins(double dFromUs, double dToUs, std::vector<Bin>* bins) const;
+    double ToMicroseconds(U32 nSamples) const { return nSamples * 1e6 / mSampleRateHz; }
+
+protected: //vars
+    U64 mScale;                     // Classes de 0.25us par echantillon, << 16
+    U32 mSampleRateHz;
+    U64 mBins[SSD_TIMING_BINS];
+    U64 mGapBins[SSD_TIMING_GAP_BINS];     // Les premieres (< 200us) restent vides
+};
+
+// What the stats export writes: the counters of a run and its wall-clock time
+struct SSDRunStats
+{
+    SSDDecoderStats mDecoder;
+    SSDTimingHistogram mTiming;     // Timing report export, with the windows below
+    SSDHBitLimits mLimits;
+    U32 mSampleRateHz;
+    U32 mThreads;
+    U64 mStartSample;               // First and last sample decoded
+    U64 mEndSample;
+    double mWallSeconds;            // Since the start of the decode, waiting for the capture included
+
+    // Plugin packet table (SSDPacketTable), not written when mTableBytes == 0
+    U64 mTableRows;
+    U64 mTablePackets;              // Repeat runs counted N times
+    U64 mTableChecksumErrors;
+    U64 mTableBytes;
+
+    SSDRunStats();
+    void WriteJson(std::string* json) const;
+};
+
+// Cost of the two clock reads around a profiled Step(), removed from each sample
+U64 SSDProfileOverheadNs();
+
+#endif //SSD_STATS_H
@@ -0,0 +1,497 @@
+// ssd-decode: decodes SSD captures outside of Logic 2 with the plugin decoder.
+//
+// Input: Logic 2 digital exports of one channel
+//   - CSV  : "Time [s],Channel 0" rows, the first one is the initial state
+//   - binary: "<SALEAE>" digital file (begin time + transition times), memory-mapped
+// Output: one record per packet, CSV or binary (see BINARY_MAGIC), or the
+// columnar file of the plugin's binary packet export (SSDColumnFile.h)
+// The throughput is printed on stderr, the decoder counters go to a JSON file
+// with --stats and the timing histograms with --timing (same content as the
+// plugin's statistics and timing report exports).
+
+#include "SSDCalibration.h"
+#include "SSDColumnFile.h"
+#include "SSDDecoder.h"
+#include "SSDEdgeSource.h"
+#include "SSDExportWriter.h"
+#include "SSDStats.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Binary output: header then fixed-size little-endian records
+//   header: "SSDPKT1\0", U32 sample rate, U32 record size
+//   record: U64 start sample, U64 end sample, U8 bytes[8] (command, data 1-6, checksum),
+//           U8 flags, U8 preamble bits, U8 data count, U8 reserved[5]
+#define BINARY_MAGIC "SSDPKT1"
+#define BINARY_RECORD_SIZE 32
+
+struct DecodeOptions
+{
+    U32 mSampleRateHz;
+    bool mTolerant;
+    bool mTracking;
+    int mCalPPM;
+    U32 mPreambleBits;
+    bool mBinary;
+    bool mColumns;                  // -f col: written at the end, mBinary is set too
+    bool mCoalesceErrors;
+    bool mAutoCal;
+    U32 mDeglitchNs;
+    bool mRecovery;
+    const char* mStats;
+    const char* mTiming;
+    const char* mInput;
+    const char* mOutput;
+};
+
+// Transitions of a CSV export, as intervals for SSDMemorySource
+struct EdgeData
+{
+    double mStartTime;              // Time of sample 0 in the export
+    std::vector<U32> mIntervals;
+    std::vector<U64> mLongs;        // Values behind INTERVAL_LONG entries
+    SSDDeglitch mDeglitch;          // Applied while loading
+
+    void AddEdge(U64 nSample, U64& nLast)
+    {
+        U64 nInterval;
+        bool bReady = mDeglitch.Push(nSample - nLast, &nInterval);
+        nLast = nSample;
+        if (bReady)
+            AddInterval(nInterval);
+    }
+
+    void AddInterval(U64 nInterval)
+    {
+        if (nInterval >= INTERVAL_LONG) {
+            mIntervals.push_back(INTERVAL_LONG);
+            mLongs.push_back(nInterval);
+        }
+        else {
+            mIntervals.push_back((U32)nInterval);
+        }
+    }
+};
+
+static U64 TimeToSample(double dTime, double dStart, U32 nSampleRateHz)
+{
+    double dSample = (dTime - dStart) * nSampleRateHz;
+    return (dSample <= 0.0) ? 0 : (U64)llround(dSample);
+}
+
+static bool LoadCsv(FILE* f, U32 nSampleRateHz, EdgeData& edges)
+{
+    char line[256];
+    bool bFirst = true;
+    U64 nLast = 0;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char* end;
+        double dTime = strtod(line, &end);
+        if (end == line || *end != ',')
+            continue;       // En-tete ou ligne vide
+
+        if (bFirst) {
+            // Etat initial au debut de la capture, pas une transition
+            edges.mStartTime = dTime;
+            bFirst = false;
+            continue;
+        }
+        edges.AddEdge(TimeToSample(dTime, edges.mStartTime, nSampleRateHz), nLast);
+    }
+
+    U64 nInterval;
+    if (edges.mDeglitch.Flush(&nInterval))
+        edges.AddInterval(nInterval);
+
+    if (bFirst) {
+        fprintf(stderr, "ssd-decode: no transitions found\n");
+        return false;
+    }
+    return true;
+}
+
+// Assembles the decoder frames into packets and writes them out
+class PacketWriter : public SSDDecoderOutput
+{
+public:
+    PacketWriter(FILE* f, const DecodeOptions& options, double dStartTime)
+        : mPackets(0),
+        mChecksumErrors(0),
+        mRecovered(0),
+        mFile(f),
+        mOptions(options),
+        mStartTime(dStartTime),
+        mPacketStart(0),
+        mPacketData(0),
+        mPreambleBits(0),
+        mDataCount(0)
+    {
+    }
+
+    static void WriteToFile(void* context, const char* data, U32 nLength)
+    {
+        fwrite(data, 1, nLength, (FILE*)context);
+    }
+
+    void WriteColumns()
+    {
+        if (!mOptions.mColumns)
+            return;
+        SSDExportWriter out(&WriteToFile, mFile);
+        mColumns.Write(out, mOptions.mSampleRateHz, 0);
+    }
+
+    void WriteHeader()
+    {
+        if (mOptions.mColumns) {
+            return;
+        }
+        else if (mOptions.mBinary) {
+            U32 nHeader[2] = { mOptions.mSampleRateHz, BINARY_RECORD_SIZE };
+            fwrite(BINARY_MAGIC, 1, 8, mFile);
+            fwrite(nHeader, 4, 2, mFile);
+        }
+        else {
+            fprintf(mFile, "Start [s],End [s],Command,Car1,Car2,Car3,Car4,Car5,Car6,Checksum,Valid,Preamble\n");
+        }
+    }
+
+    virtual void OnFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2, U8 /*nPacketMode*/)
+    {
+        switch (ft) {
+        case FRAME_PREAMBLE:
+            mPacketStart = nStartSample;
+            mPreambleBits = (U8)Data1;
+            mPacketData = 0;
+            mDataCount = 0;
+            break;
+        case FRAME_CMDBYTE:
+            mPacketData = Data1 & 0xFF;
+            break;
+        case FRAME_CARDATA:
+            if (Data2 >= 1 && Data2 <= 6) {
+                mPacketData |= (Data1 & 0xFF) << (8 * Data2);
+                mDataCount = (U8)Data2;
+            }
+            break;
+        case FRAME_CHECKSUM:
+            mPacketData |= (Data1 & 0xFF) << (8 * PACKET_CHECKSUM_INDEX);
+            WritePacket(nEndSample, Flags, (U8)Data2);
+            break;
+        default:
+            break;
+        }
+    }
+
+    virtual void OnMarker(U64 /*nSample*/, eMarkerType /*marker*/) {}
+    virtual void OnProgress(U64 /*nSample*/) {}
+
+    U64 mPackets;
+    U64 mChecksumErrors;
+    U64 mRecovered;
+
+protected:
+    void WritePacket(U64 nEndSample, U8 Flags, U8 nCalcChecksum)
+    {
+        mPackets++;
+        if ((Flags & CHECKSUM_ERROR_FLAG) != 0)
+            mChecksumErrors++;
+        else if ((Flags & RECOVERED_FLAG) != 0)
+            mRecovered++;
+
+        if (mOptions.mColumns) {
+            SSDPacketRecord packet = { mPacketStart, nEndSample, mPacketData,
+                                       mPreambleBits | ((U64)nCalcChecksum << 8) | ((U64)mDataCount << 16), 1, Flags };
+            mColumns.Add(packet);
+            return;
+        }
+        if (mOptions.mBinary) {
+            U8 record[BINARY_RECORD_SIZE];
+            memset(record, 0, sizeof(record));
+            for (int i = 0; i < 8; i++) {
+                record[i] = (U8)(mPacketStart >> (8 * i));
+                record[8 + i] = (U8)(nEndSample >> (8 * i));
+                record[16 + i] = PACKET_BYTE(mPacketData, i);
+            }
+            record[24] = Flags;
+            record[25] = mPreambleBits;
+            record[26] = mDataCount;
+            fwrite(record, 1, sizeof(record), mFile);
+            return;
+        }
+
+        fprintf(mFile, "%.9f,%.9f,0x%02X", mStartTime + (double)mPacketStart / mOptions.mSampleRateHz,
+                mStartTime + (double)nEndSample / mOptions.mSampleRateHz, PACKET_BYTE(mPacketData, 0));
+        for (int i = 1; i <= 6; i++) {
+            if (i <= mDataCount)
+                fprintf(mFile, ",0x%02X", PACKET_BYTE(mPacketData, i));
+            else
+                fprintf(mFile, ",");
+        }
+        fprintf(mFile, ",0x%02X,%d,%d\n", PACKET_BYTE(mPacketData, PACKET_CHECKSUM_INDEX),
+                (Flags & CHECKSUM_ERROR_FLAG) == 0 ? 1 : 0, mPreambleBits);
+    }
+
+    FILE* mFile;
+    const DecodeOptions& mOptions;
+    double mStartTime;
+
+    U64 mPacketStart;
+    U64 mPacketData;                // Same layout as FRAME_PACKET Data1
+    U8 mPreambleBits;
+    U8 mDataCount;
+    SSDColumnWriter mColumns;
+};
+
+template <U32 nFeatures, class Source>
+static void DecodeAs(const Source& source, const DecodeOptions& options, SSDDecoderOutput* output, SSDRunStats* stats)
+{
+    // Ni marqueurs ni progression: PacketWriter ne les lit pas
+    SSDDecoder<Source, nFeatures> decoder;
+    double dSkew = 1.0;
+    if (options.mAutoCal) {
+        // La pre-passe lit une copie de la source
+        SSDCalibration calibration(options.mSampleRateHz);
+        calibration.AddSource(source, SSD_CALIBRATION_EDGES);
+        if (calibration.Compute()) {
+            dSkew = calibration.GetSkew();
+            fprintf(stderr, "auto calibration: '1' half-bit %.2f us, '0' half-bit %.2f us, windows scaled by %+.0f PPM\n",
+                    calibration.Get1HBitCenter(), calibration.Get0HBitCenter(), (dSkew - 1.0) * 1e6);
+        }
+        else {
+            fprintf(stderr, "auto calibration: not enough '1' half-bits in %u edges, nominal timing kept\n",
+                    calibration.GetIntervalCount());
+        }
+    }
+    decoder.SetTiming(options.mSampleRateHz, options.mTolerant, options.mCalPPM, dSkew);
+    decoder.SetTracking(options.mTracking, SSDDecoderBase::GetTimingLimits(options.mSampleRateHz, true, options.mCalPPM, dSkew));
+    decoder.SetPreambleBits(options.mPreambleBits);
+    decoder.SetResync(options.mCoalesceErrors);
+    decoder.SetRecovery(options.mRecovery);
+    decoder.SetOutput(output);
+    decoder.GetEdges().SetHistogram((options.mTiming != NULL) ? options.mSampleRateHz : 0);
+    decoder.GetEdges().Init(source, 0);
+    decoder.Reset(0);
+
+    try {
+        for (;;)
+            decoder.Step();
+    }
+    catch (SSDEndOfData&) {
+        // Toutes les transitions sont decodees
+    }
+    decoder.FlushErrors();
+
+    decoder.GetStats(&stats->mDecoder);
+    stats->mEndSample = decoder.GetEdges().GetSampleNumber();
+    decoder.GetEdges().GetHistogram(&stats->mTiming);
+    stats->mLimits = decoder.GetLimits();
+}
+
+template <class Source>
+static void Decode(const Source& source, const DecodeOptions& options, SSDDecoderOutput* output, SSDRunStats* stats)
+{
+    // Temps par etat seulement si on les ecrit
+    if (options.mStats != NULL)
+        DecodeAs<SSD_FEATURE_PROFILE>(source, options, output, stats);
+    else
+        DecodeAs<0>(source, options, output, stats);
+}
+
+static void Usage()
+{
+    fprintf(stderr,
+        "usage: ssd-decode [options] <capture.csv|capture.bin>\n"
+        "  -r, --rate <Hz>       sample rate used to time the edges (default 25000000)\n"
+        "  -m, --mode <mode>     timing mode: standard, tolerant or adaptive (default standard)\n"
+        "  -p, --ppm <n>         calibration factor in PPM (default 0)\n"
+        "  -b, --preamble <n>    minimum preamble bits (default 14)\n"
+        "  -f, --format <fmt>    output format: csv, bin or col (columns, as the plugin's binary export) (default csv)\n"
+        "  -o, --output <file>   output file (default stdout)\n"
+        "  -e, --coalesce-errors count consecutive errors as one span (faster on noisy captures)\n"
+        "  -a, --auto-cal        measure the half-bit timing on the first edges and center the windows on it\n"
+        "  -g, --deglitch <ns>   merge pulses shorter than this into the surrounding interval (default 0: off)\n"
+        "  -c, --correct         recover a single marginal half-bit per packet when the checksum confirms it\n"
+        "  -s, --stats <file>    write the decoder counters (edges, half-bits, packets, errors, time per state) as JSON\n"
+        "  -t, --timing <file>   write the half-bit and gap length histograms and their margins as JSON\n");
+}
+
+static bool ParseOptions(int argc, char** argv, DecodeOptions& options)
+{
+    options.mSampleRateHz = 25000000;
+    options.mTolerant = false;
+    options.mTracking = false;
+    options.mCalPPM = 0;
+    options.mPreambleBits = 14;
+    options.mBinary = false;
+    options.mColumns = false;
+    options.mCoalesceErrors = false;
+    options.mAutoCal = false;
+    options.mDeglitchNs = 0;
+    options.mRecovery = false;
+    options.mStats = NULL;
+    options.mTiming = NULL;
+    options.mInput = NULL;
+    options.mOutput = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool bHasValue = (i + 1 < argc);
+
+        if ((arg == "-r" || arg == "--rate") && bHasValue)
+            options.mSampleRateHz = (U32)strtoul(argv[++i], NULL, 10);
+        else if ((arg == "-m" || arg == "--mode") && bHasValue) {
+            // Une faute de frappe ne doit pas donner le mode standard en silence
+            std::string mode = argv[++i];
+            if (mode != "standard" && mode != "tolerant" && mode != "adaptive")
+                return false;
+            options.mTolerant = (mode == "tolerant");
+            options.mTracking = (mode == "adaptive");
+        }
+        else if ((arg == "-p" || arg == "--ppm") && bHasValue)
+            options.mCalPPM = atoi(argv[++i]);
+        else if ((arg == "-g" || arg == "--deglitch") && bHasValue)
+            options.mDeglitchNs = (U32)strtoul(argv[++i], NULL, 10);
+        else if ((arg == "-b" || arg == "--preamble") && bHasValue)
+            options.mPreambleBits = (U32)atoi(argv[++i]);
+        else if ((arg == "-f" || arg == "--format") && bHasValue) {
+            std::string format = argv[++i];
+            if (format != "csv" && format != "bin" && format != "col")
+                return false;
+            options.mColumns = (format == "col");
+            options.mBinary = options.mColumns || (format == "bin");
+        }
+        else if ((arg == "-o" || arg == "--output") && bHasValue)
+            options.mOutput = argv[++i];
+        else if ((arg == "-s" || arg == "--stats") && bHasValue)
+            options.mStats = argv[++i];
+        else if ((arg == "-t" || arg == "--timing") && bHasValue)
+            options.mTiming = argv[++i];
+        else if (arg == "-e" || arg == "--coalesce-errors")
+            options.mCoalesceErrors = true;
+        else if (arg == "-a" || arg == "--auto-cal")
+            options.mAutoCal = true;
+        else if (arg == "-c" || arg == "--correct")
+            options.mRecovery = true;
+        else if (arg[0] != '-' && options.mInput == NULL)
+            options.mInput = argv[i];
+        else
+            return false;
+    }
+
+    return options.mInput != NULL && options.mSampleRateHz != 0;
+}
+
+static bool WriteFile(const char* path, const std::string& text)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "ssd-decode: cannot create %s\n", path);
+        return false;
+    }
+    fputs(text.c_str(), file);
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    DecodeOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        Usage();
+        return 2;
+    }
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    // Binary exports are decoded straight from the mapping, CSV ones are parsed first
+    SSDMappedFile mapped;
+    bool bBinary = mapped.Open(options.mInput);
+    EdgeData edges;
+    edges.mStartTime = 0.0;
+    edges.mDeglitch = SSDDeglitch(options.mDeglitchNs, options.mSampleRateHz);
+
+    if (!bBinary) {
+        FILE* in = fopen(options.mInput, "rb");
+        if (in == NULL) {
+            fprintf(stderr, "ssd-decode: cannot open %s\n", options.mInput);
+            return 1;
+        }
+        bool bLoaded = LoadCsv(in, options.mSampleRateHz, edges);
+        fclose(in);
+        if (!bLoaded)
+            return 1;
+    }
+    double dStartTime = bBinary ? mapped.GetBeginTime() : edges.mStartTime;
+    double dEdges = bBinary ? (double)mapped.GetTransitionCount() : (double)edges.mIntervals.size();
+
+    FILE* out = stdout;
+    if (options.mOutput != NULL) {
+        out = fopen(options.mOutput, options.mBinary ? "wb" : "w");
+        if (out == NULL) {
+            fprintf(stderr, "ssd-decode: cannot create %s\n", options.mOutput);
+            return 1;
+        }
+    }
+    static char sOutBuf[1 << 16];
+    setvbuf(out, sOutBuf, _IOFBF, sizeof(sOutBuf));
+
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+    PacketWriter writer(out, options, dStartTime);
+    writer.WriteHeader();
+    SSDRunStats stats;
+    stats.mSampleRateHz = options.mSampleRateHz;
+
+    if (bBinary)
+        Decode(SSDMappedFileSource(mapped, options.mSampleRateHz, SSDDeglitch(options.mDeglitchNs, options.mSampleRateHz)), options, &writer, &stats);
+    else
+        Decode(SSDMemorySource(edges.mIntervals.data(), edges.mIntervals.size(), edges.mLongs.data()), options, &writer, &stats);
+    writer.WriteColumns();
+
+    if (out != stdout)
+        fclose(out);
+    else
+        fflush(out);
+
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    double dLoad = std::chrono::duration<double>(t1 - t0).count();
+    double dDecode = std::chrono::duration<double>(t2 - t1).count();
+
+    fprintf(stderr, "%s: %.0f edges, %llu packets (%llu checksum errors), %llu errors\n",
+            options.mInput, dEdges, (unsigned long long)writer.mPackets,
+            (unsigned long long)writer.mChecksumErrors, (unsigned long long)stats.mDecoder.GetErrors());
+    if (options.mRecovery)
+        fprintf(stderr, "%llu packets recovered from a single bit error\n", (unsigned long long)writer.mRecovered);
+    fprintf(stderr, "load %.3f s, decode %.3f s: %.1f Medges/s, %.0f packets/s\n",
+            dLoad, dDecode, (dDecode > 0.0) ? dEdges / dDecode / 1e6 : 0.0,
+            (dDecode > 0.0) ? writer.mPackets / dDecode : 0.0);
+
+    std::string json;
+    if (options.mStats != NULL) {
+        stats.mWallSeconds = dDecode;
+        stats.WriteJson(&json);
+        if (!WriteFile(options.mStats, json))
+            return 1;
+    }
+    if (options.mTiming != NULL) {
+        static const char* sNames[3] = { "'1' half-bits", "'0' half-bits", "gaps" };
+        for (int i = 0; i < 3; i++) {
+            SSDTimingSummary summary;
+            stats.mTiming.GetSummary(stats.mLimits, (SSDTimingHistogram::ePopulation)i, &summary);
+            fprintf(stderr, "%s: %llu, %.2f to %.2f us, mean %.2f us, jitter %.2f us (p99), %llu out of [%.2f, %.2f] us\n",
+                    sNames[i], (unsigned long long)summary.mCount, summary.mMin, summary.mMax, summary.mMean,
+                    summary.mJitter99, (unsigned long long)summary.mOutside, summary.mWindowMin, summary.mWindowMax);
+        }
+        stats.mTiming.WriteJson(stats.mLimits, &json);
+        if (!WriteFile(options.mTiming, json))
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,434 @@
+// ssd-selftest: checks run by ctest that the fast paths of the decoder give
+// exactly what the reference ones do.
+//
+//   - half-bit kernels: the SSE4.1 and AVX2 Classify / Pair against the scalar
+//     ones, on random intervals around the timing windows, every length and
+//     alignment of the vector loops
+//   - parallel decoder: the frames, markers and counters of SSDParallelDecoder
+//     against those of the serial decoder, on a generated capture with gaps,
+//     truncated packets, glitches, bad checksums and marginal half-bits
+//
+// Prints the first difference found and returns 1, 0 when everything matches.
+
+#include "SSDDecoder.h"
+#include "SSDHBitKernel.h"
+#include "SSDParallelDecoder.h"
+#include <AnalyzerChannelData.h>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SELFTEST_SEED           20240601
+#define KERNEL_ROUNDS           1000    // Random arrays per set of limits
+#define KERNEL_MAX_COUNT        300     // Intervals per array
+#define KERNEL_GUARD            32      // Bytes after the outputs that must stay untouched
+#define GUARD_BYTE              0xA5
+
+#define CAPTURE_RATE_HZ         25000000
+#define CAPTURE_PACKETS         3000
+
+struct KernelVersion
+{
+    const char* mName;
+    SSDHBitKernel::ClassifyFn mClassify;
+    SSDHBitKernel::PairFn mPair;
+};
+
+static U32 RandomInterval(std::mt19937& rng, const SSDHBitLimits& limits, const std::vector<U32>& edges)
+{
+    // Surtout autour des fenetres, bornes exactes comprises
+    switch (rng() % 8) {
+    case 0:
+    case 1:
+        return edges[rng() % edges.size()];
+    case 2:
+        return (U32)rng();
+    case 3:
+        return rng() % (2 * limits.mMaxPGap + 1);
+    default:
+        return rng() % (limits.mMaxBitLen + 1);
+    }
+}
+
+static bool CheckKernel(const KernelVersion& version, const SSDHBitLimits& limits, std::mt19937& rng)
+{
+    std::vector<U32> edges;
+    const U32 bounds[] = { limits.mMin1hbit, limits.mMax1hbit, limits.mMin0hbit, limits.mMax0hbit,
+                           limits.mMinPEHold, limits.mMaxPGap, limits.mMaxBitLen / 2, 0, 0xFFFFFFFF };
+    for (size_t k = 0; k < sizeof(bounds) / sizeof(bounds[0]); k++) {
+        edges.push_back(bounds[k]);
+        edges.push_back(bounds[k] - 1);
+        edges.push_back(bounds[k] + 1);
+    }
+
+    std::vector<U32> intervals(KERNEL_MAX_COUNT + 8);
+    std::vector<U8> refClasses(KERNEL_MAX_COUNT + 8 + KERNEL_GUARD), classes(refClasses.size());
+    std::vector<U8> refBits(refClasses.size()), bits(refClasses.size());
+
+    for (U32 nRound = 0; nRound < KERNEL_ROUNDS; nRound++) {
+        U32 nOffset = rng() % 8;    // Vecteurs non alignes
+        U32 nCount = rng() % (KERNEL_MAX_COUNT + 1);
+        for (U32 i = 0; i < nCount; i++)
+            intervals[nOffset + i] = RandomInterval(rng, limits, edges);
+
+        memset(refClasses.data(), GUARD_BYTE, refClasses.size());
+        memset(classes.data(), GUARD_BYTE, classes.size());
+        SSDHBitKernel::ClassifyScalar(limits, intervals.data() + nOffset, refClasses.data() + nOffset, nCount);
+        version.mClassify(limits, intervals.data() + nOffset, classes.data() + nOffset, nCount);
+        if (classes != refClasses) {
+            for (size_t i = 0; i < classes.size(); i++) {
+                if (classes[i] != refClasses[i]) {
+                    fprintf(stderr, "Classify %s: count %u offset %u, class[%d] = %u instead of %u (interval %u)\n",
+                            version.mName, nCount, nOffset, (int)i - (int)nOffset, classes[i], refClasses[i],
+                            (i >= nOffset && i < nOffset + nCount) ? intervals[i] : 0);
+                    break;
+                }
+            }
+            return false;
+        }
+
+        // Pair lit les classes du scalaire: une erreur de Classify est signalee au-dessus
+        memset(refBits.data(), GUARD_BYTE, refBits.size());
+        memset(bits.data(), GUARD_BYTE, bits.size());
+        SSDHBitKernel::PairScalar(limits, intervals.data() + nOffset, refClasses.data() + nOffset, refBits.data() + nOffset, nCount);
+        version.mPair(limits, intervals.data() + nOffset, refClasses.data() + nOffset, bits.data() + nOffset, nCount);
+        if (bits != refBits) {
+            for (size_t i = 0; i < bits.size(); i++) {
+                if (bits[i] != refBits[i]) {
+                    fprintf(stderr, "Pair %s: count %u offset %u, bit[%d] = %u instead of %u\n",
+                            version.mName, nCount, nOffset, (int)i - (int)nOffset, bits[i], refBits[i]);
+                    break;
+                }
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool CheckKernels()
+{
+    std::vector<KernelVersion> versions;
+#ifdef SSD_KERNEL_X86
+    if (SSDHBitKernel::HasSSE41()) {
+        KernelVersion version = { "SSE4.1", SSDHBitKernel::ClassifySSE41, SSDHBitKernel::PairSSE41 };
+        versions.push_back(version);
+    }
+    if (SSDHBitKernel::HasAVX2()) {
+        KernelVersion version = { "AVX2", SSDHBitKernel::ClassifyAVX2, SSDHBitKernel::PairAVX2 };
+        versions.push_back(version);
+    }
+#endif
+    if (versions.empty()) {
+        printf("kernels: no SIMD version on this CPU, nothing to compare\n");
+        return true;
+    }
+
+    // Limites des deux modes a plusieurs frequences, et des fenetres decalees par la calibration
+    const U32 rates[] = { 4000000, 12000000, 25000000, 100000000, 500000000 };
+    std::mt19937 rng(SELFTEST_SEED);
+    bool bOk = true;
+
+    for (size_t v = 0; v < versions.size(); v++) {
+        U32 nLimits = 0;
+        bool bVersionOk = true;
+        for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+            for (int nTolerant = 0; nTolerant < 2; nTolerant++) {
+                for (int nPPM = -20000; nPPM <= 20000; nPPM += 20000) {
+                    SSDHBitLimits limits = SSDDecoderBase::GetTimingLimits(rates[r], nTolerant != 0, nPPM);
+                    if (!CheckKernel(versions[v], limits, rng)) {
+                        fprintf(stderr, "kernels: %s differs from scalar (%u Hz, %s, %+d PPM)\n", versions[v].mName,
+                                rates[r], nTolerant ? "tolerant" : "standard", nPPM);
+                        bVersionOk = false;
+                    }
+                    nLimits++;
+                }
+            }
+        }
+        if (bVersionOk)
+            printf("kernels: %s = scalar on %u sets of limits x %u arrays\n", versions[v].mName, nLimits, KERNEL_ROUNDS);
+        bOk = bOk && bVersionOk;
+    }
+    return bOk;
+}
+
+// ---------------------------------------------------------------------------
+// Parallel decoder
+
+// The whole capture is handed to SSDParallelDecoder as already read, with a
+// NULL channel: the SDK library is never called and these stand in for it.
+U64 AnalyzerChannelData::GetSampleNumber() { abort(); }
+void AnalyzerChannelData::AdvanceToNextEdge() { abort(); }
+bool AnalyzerChannelData::DoMoreTransitionsExistInCurrentData() { abort(); }
+
+// Generated capture: intervals between edges, ended by one INTERVAL_LONG
+class CaptureGenerator
+{
+public:
+    explicit CaptureGenerator(std::mt19937& rng)
+        : mRng(rng),
+        mJitter(0.0, 1.5)
+    {
+    }
+
+    void HalfBit(double dUs)
+    {
+        double dSamples = (dUs + mJitter(mRng)) * (CAPTURE_RATE_HZ / 1e6);
+        mIntervals.push_back((dSamples < 1.0) ? 1 : (U32)lround(dSamples));
+    }
+
+    void Bit(int nBit)
+    {
+        HalfBit(nBit ? 58.0 : 116.0);
+        HalfBit(nBit ? 58.0 : 116.0);
+    }
+
+    void Byte(U8 nVal)
+    {
+        for (int i = 7; i >= 0; i--)
+            Bit((nVal >> i) & 1);
+    }
+
+    void Gap(double dUs)
+    {
+        mIntervals.push_back((U32)(dUs * (CAPTURE_RATE_HZ / 1e6)));
+    }
+
+    void Packet()
+    {
+        U8 bytes[8];
+        U32 nDamage = mRng() % 100;
+        bytes[0] = (mRng() % 4 == 0) ? 0x01 : 0x02;
+        bytes[7] = 0xFF ^ bytes[0];
+        for (int i = 1; i <= 6; i++) {
+            bytes[i] = (U8)mRng();
+            bytes[7] ^= bytes[i];
+        }
+        if (nDamage < 4)
+            bytes[7] ^= 1 << (mRng() % 8);                  // Checksum faux
+
+        // Bits du paquet, le PE bit compris
+        std::vector<int> bits(16, 1);
+        for (int i = 0; i < 8; i++) {
+            bits.push_back(0);
+            for (int k = 7; k >= 0; k--)
+                bits.push_back((bytes[i] >> k) & 1);
+        }
+        bits.push_back(1);
+
+        size_t nCut = bits.size();
+        if (nDamage >= 4 && nDamage < 8)
+            nCut = mRng() % bits.size();                    // Paquet tronque
+        size_t nHit = mRng() % bits.size();
+
+        for (size_t i = 0; i < nCut; i++) {
+            if (i != nHit || nDamage < 8 || nDamage >= 18) {
+                Bit(bits[i]);
+                continue;
+            }
+            double dHalf = bits[i] ? 58.0 : 116.0;
+            if (nDamage < 11) {
+                // Glitch au milieu d'un demi-bit
+                HalfBit(dHalf / 3);
+                HalfBit(0.5);
+                HalfBit(dHalf * 2 / 3);
+                HalfBit(dHalf);
+            }
+            else if (nDamage < 14) {
+                HalfBit(85.0);                              // Demi-bit entre les fenetres
+                HalfBit(dHalf);
+            }
+            else if (nDamage < 16) {
+                for (int k = 0; k < 5; k++)
+                    HalfBit(1.0 + mRng() % 400);            // Bruit
+            }
+            else {
+                Bit(bits[i]);
+                Gap(2000.0);                                // Gap au milieu du paquet
+            }
+        }
+
+        // Gaps courts (PROGRAM repete), normaux, et trop longs pour un gap de paquet
+        U32 nGap = mRng() % 100;
+        Gap((nGap < 10) ? 100.0 : (nGap < 13) ? 40000.0 : 3000.0 + mRng() % 2000);
+    }
+
+    void End(U64* nLong)
+    {
+        *nLong = (U64)INTERVAL_LONG + 1000;
+        mIntervals.push_back(INTERVAL_LONG);
+    }
+
+    std::vector<U32> mIntervals;
+
+protected:
+    std::mt19937& mRng;
+    std::normal_distribution<double> mJitter;
+};
+
+// Frames and markers in the order they are posted; progress is not compared
+// (the parallel decoder reports it once per chunk)
+class EventRecorder : public SSDDecoderOutput
+{
+public:
+    struct Event
+    {
+        U64 mStart, mEnd;
+        U64 mData1, mData2;
+        int mType;                  // eFrameType, or -1 - eMarkerType
+        U8 mFlags;
+        U8 mPacketMode;
+
+        bool operator!=(const Event& other) const
+        {
+            return mStart != other.mStart || mEnd != other.mEnd || mData1 != other.mData1 || mData2 != other.mData2 ||
+                   mType != other.mType || mFlags != other.mFlags || mPacketMode != other.mPacketMode;
+        }
+    };
+
+    virtual void OnFrame(U64 nStartSample, U64 nEndSample, eFrameType ft, U8 Flags, U64 Data1, U64 Data2, U8 nPacketMode)
+    {
+        Event event = { nStartSample, nEndSample, Data1, Data2, (int)ft, Flags, nPacketMode };
+        mEvents.push_back(event);
+    }
+
+    virtual void OnMarker(U64 nSample, eMarkerType marker)
+    {
+        Event event = { nSample, nSample, 0, 0, -1 - (int)marker, 0, 0 };
+        mEvents.push_back(event);
+    }
+
+    virtual void OnProgress(U64 /*nSample*/) {}
+
+    std::vector<Event> mEvents;
+};
+
+struct DecodeSetup
+{
+    bool mTolerant;
+    bool mResync;
+    bool mRecovery;
+};
+
+static void Configure(SSDChannelDecoder& decoder, const DecodeSetup& setup, SSDDecoderOutput* output)
+{
+    // Comme SSDAnalyzer::Setup
+    decoder.SetTiming(CAPTURE_RATE_HZ, setup.mTolerant, 0);
+    decoder.SetPreambleBits(14);
+    decoder.SetResync(setup.mResync);
+    decoder.SetRecovery(setup.mRecovery);
+    decoder.SetOutput(output);
+}
+
+static void DecodeSerial(const std::vector<U32>& intervals, const U64* nLong, const DecodeSetup& setup,
+                         EventRecorder* output, SSDDecoderStats* stats)
+{
+    SSDChannelDecoder decoder;
+    Configure(decoder, setup, output);
+    decoder.GetEdges().Init(SSDChannelSource(SSDMemorySource(intervals.data(), intervals.size(), nLong), NULL), 0);
+    decoder.Reset(0);
+
+    try {
+        for (;;)
+            decoder.Step();
+    }
+    catch (SSDEndOfData&) {
+    }
+    decoder.FlushErrors();
+    decoder.GetStats(stats);
+}
+
+static void DecodeParallel(const std::vector<U32>& intervals, U64 nLong, U32 nThreads, const DecodeSetup& setup,
+                           EventRecorder* output, SSDDecoderStats* stats)
+{
+    // Toute la capture est deja "lue" (intervalles de calibration): pas de canal
+    SSDChannelDecoder decoder;
+    Configure(decoder, setup, output);
+    decoder.GetEdges().Init(SSDChannelSource(SSDMemorySource(), NULL), 0);
+    decoder.Reset(0);
+
+    SSDParallelDecoder parallel;
+    parallel.Init(nThreads, 0, intervals.data(), (U32)intervals.size(), nLong);
+    while (parallel.DecodeBatch(decoder, NULL)) {
+    }
+
+    try {
+        for (;;)
+            decoder.Step();
+    }
+    catch (SSDEndOfData&) {
+    }
+    decoder.FlushErrors();
+    decoder.GetStats(stats);
+}
+
+static bool SameStats(const SSDDecoderStats& a, const SSDDecoderStats& b)
+{
+    // Sans mSteps / mStateNs: le profil depend du decoupage
+    return a.mEdges == b.mEdges && memcmp(a.mHBits, b.mHBits, sizeof(a.mHBits)) == 0 &&
+           memcmp(a.mPackets, b.mPackets, sizeof(a.mPackets)) == 0 && a.mChecksumErrors == b.mChecksumErrors &&
+           a.mRecovered == b.mRecovered && memcmp(a.mErrors, b.mErrors, sizeof(a.mErrors)) == 0 && a.mErrorEvents == b.mErrorEvents &&
+           a.mResyncs == b.mResyncs;
+}
+
+static bool CheckParallel()
+{
+    std::mt19937 rng(SELFTEST_SEED);
+    CaptureGenerator capture(rng);
+    for (int i = 0; i < CAPTURE_PACKETS; i++)
+        capture.Packet();
+    U64 nLong;
+    capture.End(&nLong);
+
+    const U32 threads[] = { 2, 3, 4, 8 };
+    bool bOk = true;
+    U32 nRuns = 0;
+
+    for (int nSetup = 0; nSetup < 8; nSetup++) {
+        DecodeSetup setup = { (nSetup & 1) != 0, (nSetup & 2) != 0, (nSetup & 4) != 0 };
+        EventRecorder serial;
+        SSDDecoderStats serialStats;
+        DecodeSerial(capture.mIntervals, &nLong, setup, &serial, &serialStats);
+
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            EventRecorder parallel;
+            SSDDecoderStats parallelStats;
+            DecodeParallel(capture.mIntervals, nLong, threads[t], setup, &parallel, &parallelStats);
+            nRuns++;
+
+            size_t nCount = (serial.mEvents.size() < parallel.mEvents.size()) ? serial.mEvents.size() : parallel.mEvents.size();
+            size_t i = 0;
+            while (i < nCount && !(serial.mEvents[i] != parallel.mEvents[i]))
+                i++;
+            if (i == nCount && serial.mEvents.size() == parallel.mEvents.size() && SameStats(serialStats, parallelStats))
+                continue;
+
+            fprintf(stderr, "parallel: %u threads, %s%s%s differs from serial: ", threads[t],
+                    setup.mTolerant ? "tolerant" : "standard", setup.mResync ? ", resync" : "", setup.mRecovery ? ", recovery" : "");
+            if (i < nCount)
+                fprintf(stderr, "event %u: type %d at %llu instead of type %d at %llu\n", (U32)i,
+                        parallel.mEvents[i].mType, (unsigned long long)parallel.mEvents[i].mStart,
+                        serial.mEvents[i].mType, (unsigned long long)serial.mEvents[i].mStart);
+            else if (serial.mEvents.size() != parallel.mEvents.size())
+                fprintf(stderr, "%u events instead of %u\n", (U32)parallel.mEvents.size(), (U32)serial.mEvents.size());
+            else
+                fprintf(stderr, "counters\n");
+            bOk = false;
+        }
+    }
+
+    if (bOk)
+        printf("parallel: = serial on %u intervals, %u runs\n", (U32)capture.mIntervals.size(), nRuns);
+    return bOk;
+}
+
+int main()
+{
+    bool bOk = CheckKernels();
+    bOk = CheckParallel() && bOk;
+    printf("%s\n", bOk ? "ssd-selftest: passed" : "ssd-selftest: FAILED");
+    return bOk ? 0 : 1;
+}